@@ -27,7 +27,37 @@
       "cflags_cc!": [ "-fno-exceptions" ],
       'defines': [ 'NAPI_DISABLE_CPP_EXCEPTIONS', 'NODE_API_SWALLOW_UNTHROWABLE_EXCEPTIONS' ],
       "sources": [
-          "<!@(find shell -name \"*.cc\")",
+          "<!@(find shell/common -name \"*.cc\")",
+      ],
+    },
+    {
+      "target_name": "asar_pack",
+      "type": "executable",
+      "sources": [
+          "<!@(find shell/common/asar -name \"*.cc\")",
+          "shell/tools/asar_pack.cc",
+      ],
+      "conditions": [
+        ["OS=='win'", {
+          "libraries": [ "libcrypto.lib" ],
+        }, {
+          "libraries": [ "-lcrypto", "-lpthread" ],
+        }],
+      ],
+    },
+    {
+      "target_name": "asar_convert",
+      "type": "executable",
+      "sources": [
+          "<!@(find shell/common/asar -name \"*.cc\")",
+          "shell/tools/asar_convert.cc",
+      ],
+      "conditions": [
+        ["OS=='win'", {
+          "libraries": [ "libcrypto.lib" ],
+        }, {
+          "libraries": [ "-lcrypto", "-lpthread" ],
+        }],
       ],
     }
   ]
@@ -16,6 +16,50 @@ export interface RegisterOptions {
      * @default true
      */
     mirrorAsarBasePath?: boolean;
+    /**
+     * Limit temporary files extracted out of the archives, e.g. for `child_process` and `process.dlopen`.
+     * Files opened through `fs` are kept until closed, loaded addons for good.
+     * @default unlimited
+     */
+    fileOutLimits?: FileOutLimits;
+    /**
+     * Validate file contents with the integrity info written into the archive
+     * header by `@electron/asar`. The header itself is trusted.
+     * @default false
+     */
+    validateIntegrity?: boolean;
+    /**
+     * Cache of directory probes for "*.asar" paths outside registered archives.
+     */
+    directoryCache?: DirectoryCacheOptions;
+    /**
+     * Reload archives whose file is replaced while the process runs, e.g. by a deploy.
+     * Already running operations finish with the old archive.
+     */
+    reload?: ArchiveReloadOptions;
+    /**
+     * Open archives as overlays of patch archives stacked over them, lowest first, e.g.
+     * `{'/opt/app/app.asar': ['/opt/app/hotfix.asar']}`. Files of upper layers shadow the
+     * lower ones, `.wh.<name>` entries delete `<name>` and `.wh..wh..opq` a whole directory.
+     */
+    overlays?: Record<string, string[]>;
+    /**
+     * Index the paths of all opened archives in one hash table, so that module resolution
+     * probes are answered with a single lookup. Registered archives are opened eagerly.
+     * @default false
+     */
+    pathIndex?: boolean;
+    /**
+     * Unload archives not accessed for about this long, they are opened again on the next access.
+     * @default 0, never
+     */
+    unloadIdleMs?: number;
+    /**
+     * Extra module mappings from a directory to a location inside an archive,
+     * e.g. `{'/opt/app/plugins': '/opt/app/plugins.asar/dist'}`.
+     * The deepest matching mount point wins, target archives must also be listed in `archives`.
+     */
+    mounts?: Record<string, string>;
 }
 
 export interface Register {
@@ -48,13 +92,247 @@ export interface AsarFileInfo {
     }
 }
 
+export interface FileOutLimits {
+    /**
+     * Maximum total bytes of temporary files extracted by `copyFileOut`, 0 means unlimited.
+     */
+    maxBytes?: number;
+    /**
+     * Maximum count of temporary files extracted by `copyFileOut`, 0 means unlimited.
+     */
+    maxEntries?: number;
+}
+
+export interface ExtractTreeOptions {
+    /**
+     * Number of threads used to read and write file contents.
+     * Defaults to the number of CPU cores.
+     */
+    concurrency?: number;
+}
+
+export interface ExtractTreeResult {
+    files: number;
+    links: number;
+    directories: number;
+    bytes: number;
+    elapsedMs: number;
+    bytesPerSecond: number;
+}
+
+export interface IntegrityStats {
+    /** Files validated once and skipped on later reads. */
+    verifiedFiles: number;
+    hashedBytes: number;
+    hashMs: number;
+    /** Reads of already validated files that skipped hashing. */
+    skippedReads: number;
+    skippedBytes: number;
+    /** Hash time saved by skipped reads. */
+    savedMs: number;
+}
+
+export interface VerifyAllEvent {
+    verifiedFiles: number;
+    failedFiles: number;
+    totalFiles: number;
+    verifiedBytes: number;
+    totalBytes: number;
+    /** Set when the event reports a file failing validation. */
+    failedPath?: string;
+}
+
+export interface VerifyAllOptions {
+    /** Number of hashing threads, defaults to the number of CPU cores. */
+    threads?: number;
+}
+
+export interface DirectoryCacheOptions {
+    /** Maximum number of cached paths. @default 8192 */
+    maxEntries?: number;
+    /** Expire cached paths after `ttlMs`, 0 keeps them until invalidated. @default 0 */
+    ttlMs?: number;
+    /**
+     * Invalidate cached paths on changes of their parent directory, Linux only. Paths whose parent
+     * cannot be watched expire after `ttlMs`, or after a second when it is 0. @default true
+     */
+    watch?: boolean;
+}
+
+export interface ArchiveReloadOptions {
+    /** @default true */
+    enabled?: boolean;
+    /** Minimum time between checks of an archive file on access. @default 1000 */
+    checkIntervalMs?: number;
+    /** Check as soon as the directory of an archive changes, Linux only. @default true */
+    watch?: boolean;
+}
+
+export interface ArchiveReloadStats {
+    enabled: boolean;
+    /** Archives replaced by a newer file since startup. */
+    reloads: number;
+}
+
+export interface ArchiveMemoryUsage {
+    path: string;
+    /** Estimated size of the parsed header. */
+    headerBytes: number;
+    /** Size of the path index built from the header. */
+    indexBytes: number;
+    /** Address space of the binary header mapping, paged in on demand. */
+    mappedBytes: number;
+    /** Temporary files copied out of the archive. */
+    extractedFiles: number;
+    extractedBytes: number;
+}
+
+export interface ArchiveMemoryStats {
+    /** Opened archives. */
+    archives: ArchiveMemoryUsage[];
+    /** Unloaded archives not released yet because they are still referenced. */
+    pendingUnloads: number;
+}
+
+export interface PathIndexStats {
+    enabled: boolean;
+    /** Indexed archives, the opened ones. */
+    archives: number;
+    entries: number;
+    /** Memory taken by the indexed paths. */
+    bytes: number;
+}
+
+export interface DirectoryCacheStats {
+    hits: number;
+    misses: number;
+    evictions: number;
+    invalidations: number;
+    /** Lookups that waited for another thread. */
+    contentions: number;
+    /** Lookups cached with a TTL, their parent directory could not be watched. */
+    unwatched: number;
+    entries: number;
+}
+
+export interface Mount {
+    mountPoint: string;
+    target: string;
+}
+
+export interface WalkOptions {
+    /** Levels to descend, 1 lists direct children only. @default 0, unlimited */
+    maxDepth?: number;
+}
+
+export interface WalkResult {
+    paths: string[];
+    types: Uint8Array;
+}
+
 export interface ArchiveBinding {
     getFileInfo(path: string): AsarFileInfo | false;
     stat(path: string): AsarFileStat | false;
+    /**
+     * The type of `path`, or 0 if it does not exist. Cheaper than `stat` as no object is created.
+     */
+    statType(path: string): FileType | 0;
+    /**
+     * The size of `path`, or -1 if it does not exist.
+     */
+    size(path: string): number;
+    /**
+     * Write `[size, offset]` of `path` into `values` and return its type, or 0 if it
+     * does not exist. Lets callers reuse one array instead of allocating per stat.
+     */
+    statInto(path: string, values: Float64Array): FileType | 0;
     readdir(path: string): string[] | false;
+    /**
+     * Names and UV dirent types of the children of `path` in one call.
+     */
+    readdirWithTypes(path: string): { names: string[], types: Uint8Array } | false;
+    /**
+     * All descendants of the directory `path`, depth first, as paths relative to it and their
+     * UV dirent types. Links are not followed.
+     */
+    walk(path: string, options?: WalkOptions): WalkResult | false;
+    /**
+     * Same as `walk`, but runs on the thread pool. Rejects if `path` is not a directory.
+     */
+    walkAsync(path: string, options?: WalkOptions): Promise<WalkResult>;
     realpath(path: string): string | false;
+    /**
+     * Async variants of `getFileInfo`, `stat`, `readdir` and `realpath`, run on the
+     * thread pool and resolved with the same values.
+     */
+    getFileInfoAsync(path: string): Promise<AsarFileInfo | false>;
+    statAsync(path: string): Promise<AsarFileStat | false>;
+    readdirAsync(path: string): Promise<string[] | false>;
+    realpathAsync(path: string): Promise<string | false>;
+    /**
+     * Read a packed file, or `length` bytes of it at `position`. Integrity blocks
+     * touched by the read are validated, throws on integrity violation.
+     * With an `encoding` the content is decoded natively into a string.
+     */
+    read(path: string, position?: number, length?: number): Buffer | false;
+    read(path: string, position: number | undefined, length: number | undefined, encoding: 'utf8' | 'utf-8' | 'latin1' | 'binary'): string | false;
+    /**
+     * Read a packed file as a UTF-8 string. ASCII content is exposed without
+     * copying where the runtime supports external strings, throws on
+     * integrity violation.
+     */
+    readSource(path: string): string | false;
+    /**
+     * Map the packed file `path` on its own, zero-copy. Writes to the buffer
+     * stay private to it. Files packed with `asar_pack --align` start at a
+     * page boundary. Throws on integrity violation.
+     */
+    mapEntry(path: string): ArrayBuffer | false;
+    /**
+     * Validate `buffer` read out of the packed file `path`, files already
+     * validated are not hashed again.
+     */
+    validateIntegrity(path: string, buffer: Buffer): boolean;
+    getIntegrityStats(): IntegrityStats;
+    /**
+     * Validate all files of the archive in the background, so that later reads
+     * skip hashing. Progress and failures are reported to `callback`.
+     */
+    verifyAll(options?: VerifyAllOptions, callback?: (event: VerifyAllEvent) => void): Promise<VerifyAllEvent>;
     copyFileOut(path: string): string | false;
-    getFdAndValidateIntegrityLater(): number | -1;
+    /**
+     * Same with `copyFileOut`, but the temporary file will not be evicted
+     * until `releaseFileOut` is called with the same path.
+     */
+    acquireFileOut(path: string): string | false;
+    releaseFileOut(path: string): boolean;
+    /**
+     * Limit temporary files extracted by `copyFileOut`, least recently used
+     * files not acquired by `acquireFileOut` are removed when exceeded.
+     */
+    setFileOutLimits(limits: FileOutLimits): void;
+    /**
+     * Extract the directory `path` of the archive into `destDir` on real disk,
+     * throws if any entry fails to extract or fails the integrity check.
+     */
+    extractTree(path: string, destDir: string, options?: ExtractTreeOptions): ExtractTreeResult;
+    /** Same as `extractTree`, extracting on the libuv thread pool. */
+    extractTreeAsync(path: string, destDir: string, options?: ExtractTreeOptions): Promise<ExtractTreeResult>;
+    /**
+     * The fd to read packed files from at their offset, the one of the layer holding
+     * `path` for overlay archives. The fd stays open across reloads until it is
+     * passed to `releaseFd`.
+     */
+    getFdAndValidateIntegrityLater(path?: string): number | -1;
+    /** Release an fd from `getFdAndValidateIntegrityLater`, false if it was not handed out. */
+    releaseFd(fd: number): boolean;
+    /**
+     * Switch to the reloaded archive after the file was replaced, see `ArchiveReloadOptions`.
+     * Returns whether the archive changed.
+     */
+    refresh(): boolean;
+    /** Approximate memory held by the archive, `null` once unloaded. */
+    getMemoryUsage(): ArchiveMemoryUsage | null;
     readonly archivePath: string;
 }
 
@@ -84,8 +362,36 @@ export interface AsarArchives {
      * @param filepath - The file path to resolve.
      */
     resolveArchiveMapping(filepath: string): string | null;
+    /**
+     * Map `mountPoint` and everything below it to `target`, which may be an
+     * archive or a directory inside one.
+     */
+    mount(mountPoint: string, target: string): void;
+    /**
+     * Remove a mapping added by `mount` or `mirrorAsarBasePath`.
+     */
+    unmount(mountPoint: string): boolean;
+    /**
+     * Close the archive, it is opened again on the next access. Returns the memory it held,
+     * released once operations still using it finish, or false if it was not open.
+     */
+    unload(archivePath: string): ArchiveMemoryUsage | false;
+    /**
+     * Stack `layers` over the archive, lowest first, see `LoadArchiveOptions.overlays`.
+     * An empty array removes the overlay. Takes effect on the next access.
+     */
+    setOverlay(archivePath: string, layers: string[]): void;
+    /**
+     * Unload archives not accessed for between `idleMs` and twice as long, 0 disables it.
+     */
+    setUnloadIdle(idleMs: number): void;
+    /** Memory held by the opened archives. */
+    getMemoryStats(): ArchiveMemoryStats;
 }
 
 export declare const register: Register;
 export declare const getOrCreateArchive: GetOrCreateArchive;
-export declare const archives: AsarArchives;
\ No newline at end of file
+export declare const archives: AsarArchives;
+export declare const getDirectoryCacheStats: () => DirectoryCacheStats;
+export declare const getArchiveReloadStats: () => ArchiveReloadStats;
+export declare const getPathIndexStats: () => PathIndexStats;
\ No newline at end of file
@@ -3,6 +3,7 @@
 // found in the LICENSE file.
 
 #include <napi.h>
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <memory>
@@ -10,23 +11,111 @@
 #include <fstream>
 #include <optional>
 #include <unordered_map>
+#include <chrono>
 #include <cstdint>
+#include <cstring>
+#include <functional>
+#include <thread>
 #include "../asar/archive.h"
 #include "../asar/asar_util.h"
+#include "../asar/directory_cache.h"
+#include "../asar/mount_table.h"
+#include "../asar/path_index.h"
+#include "../asar/scoped_temporary_file.h"
+#include "../asar/text.h"
 
 namespace fs = std::filesystem;
 
+Napi::Object MemoryUsageToObject(Napi::Env env, const asar::Archive& archive) {
+    asar::Archive::MemoryUsage usage = archive.GetMemoryUsage();
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("path", Napi::String::New(env, archive.path().string()));
+    result.Set("headerBytes", Napi::Number::New(env, static_cast<double>(usage.header_bytes)));
+    result.Set("indexBytes", Napi::Number::New(env, static_cast<double>(usage.index_bytes)));
+    result.Set("mappedBytes", Napi::Number::New(env, static_cast<double>(usage.mapped_bytes)));
+    result.Set("extractedFiles", Napi::Number::New(env, static_cast<double>(usage.extracted_files)));
+    result.Set("extractedBytes", Napi::Number::New(env, static_cast<double>(usage.extracted_bytes)));
+    return result;
+}
+
+// Runs |execute| on the libuv thread pool, then settles a promise on the JS
+// thread with the value made by |complete|, or with an Error when |execute|
+// returns false.
+class PromiseWorker : public Napi::AsyncWorker {
+public:
+    using ExecuteCallback = std::function<bool(std::string* error)>;
+    using CompleteCallback = std::function<Napi::Value(Napi::Env env)>;
+
+    static Napi::Promise Run(Napi::Env env, ExecuteCallback execute, CompleteCallback complete) {
+        PromiseWorker* worker = new PromiseWorker(env, std::move(execute), std::move(complete));
+        Napi::Promise promise = worker->deferred_.Promise();
+        worker->Queue();
+        return promise;
+    }
+
+protected:
+    void Execute() override {
+        std::string error;
+        if (!execute_(&error)) {
+            SetError(error);
+        }
+    }
+
+    void OnOK() override {
+        deferred_.Resolve(complete_(Env()));
+    }
+
+    void OnError(const Napi::Error& error) override {
+        deferred_.Reject(error.Value());
+    }
+
+private:
+    PromiseWorker(Napi::Env env, ExecuteCallback execute, CompleteCallback complete)
+        : Napi::AsyncWorker(env),
+          deferred_(Napi::Promise::Deferred::New(env)),
+          execute_(std::move(execute)),
+          complete_(std::move(complete)) {}
+
+    Napi::Promise::Deferred deferred_;
+    ExecuteCallback execute_;
+    CompleteCallback complete_;
+};
+
 // N-API wrapper class
 class ArchiveWrapper : public Napi::ObjectWrap<ArchiveWrapper> {
 public:
     static Napi::Object Init(Napi::Env env, Napi::Object exports) {
         Napi::Function func = DefineClass(env, "Archive", {
             InstanceMethod("getFileInfo", &ArchiveWrapper::GetFileInfo),
+            InstanceMethod("getFileInfoAsync", &ArchiveWrapper::GetFileInfoAsync),
+            InstanceMethod("statAsync", &ArchiveWrapper::StatAsync),
+            InstanceMethod("readdirAsync", &ArchiveWrapper::ReaddirAsync),
+            InstanceMethod("realpathAsync", &ArchiveWrapper::RealpathAsync),
             InstanceMethod("stat", &ArchiveWrapper::Stat),
+            InstanceMethod("statType", &ArchiveWrapper::StatType),
+            InstanceMethod("size", &ArchiveWrapper::Size),
+            InstanceMethod("statInto", &ArchiveWrapper::StatInto),
             InstanceMethod("readdir", &ArchiveWrapper::Readdir),
+            InstanceMethod("readdirWithTypes", &ArchiveWrapper::ReaddirWithTypes),
+            InstanceMethod("walk", &ArchiveWrapper::Walk),
+            InstanceMethod("walkAsync", &ArchiveWrapper::WalkAsync),
             InstanceMethod("realpath", &ArchiveWrapper::Realpath),
+            InstanceMethod("read", &ArchiveWrapper::Read),
+            InstanceMethod("readSource", &ArchiveWrapper::ReadSource),
+            InstanceMethod("mapEntry", &ArchiveWrapper::MapEntry),
+            InstanceMethod("validateIntegrity", &ArchiveWrapper::ValidateIntegrity),
+            InstanceMethod("getIntegrityStats", &ArchiveWrapper::GetIntegrityStats),
+            InstanceMethod("verifyAll", &ArchiveWrapper::VerifyAll),
             InstanceMethod("copyFileOut", &ArchiveWrapper::CopyFileOut),
+            InstanceMethod("acquireFileOut", &ArchiveWrapper::AcquireFileOut),
+            InstanceMethod("releaseFileOut", &ArchiveWrapper::ReleaseFileOut),
+            InstanceMethod("setFileOutLimits", &ArchiveWrapper::SetFileOutLimits),
+            InstanceMethod("extractTree", &ArchiveWrapper::ExtractTree),
+            InstanceMethod("extractTreeAsync", &ArchiveWrapper::ExtractTreeAsync),
             InstanceMethod("getFdAndValidateIntegrityLater", &ArchiveWrapper::GetFD),
+            InstanceMethod("releaseFd", &ArchiveWrapper::ReleaseFD),
+            InstanceMethod("refresh", &ArchiveWrapper::Refresh),
+            InstanceMethod("getMemoryUsage", &ArchiveWrapper::GetMemoryUsage),
             InstanceAccessor("archivePath", &ArchiveWrapper::GetArchivePath, nullptr),
         });
 
@@ -58,22 +147,17 @@ public:
 
 private:
     std::shared_ptr<asar::Archive> archive_;
+    // Temporary files pinned by acquireFileOut, one handle per acquire.
+    std::unordered_map<std::string, std::vector<std::shared_ptr<asar::ScopedTemporaryFile>>> file_out_handles_;
+    // Archives whose fd was handed out by getFdAndValidateIntegrityLater, by
+    // fd, with the number of handles not released yet.
+    struct FdHold {
+        std::shared_ptr<asar::Archive> archive;
+        uint32_t count = 0;
+    };
+    std::unordered_map<int, FdHold> fd_holds_;
 
-    Napi::Value GetFileInfo(const Napi::CallbackInfo& info) {
-        Napi::Env env = info.Env();
-
-        if (info.Length() < 1 || !info[0].IsString()) {
-            return Napi::Boolean::New(env, false);
-        }
-
-        std::string path_str = info[0].As<Napi::String>();
-        fs::path path(path_str);
-
-        asar::Archive::FileInfo file_info;
-        if (!archive_ || !archive_->GetFileInfo(path, &file_info)) {
-            return Napi::Boolean::New(env, false);
-        }
-
+    static Napi::Object FileInfoToObject(Napi::Env env, const asar::Archive::FileInfo& file_info) {
         Napi::Object result = Napi::Object::New(env);
         result.Set("size", Napi::Number::New(env, file_info.size));
         result.Set("unpacked", Napi::Boolean::New(env, file_info.unpacked));
@@ -99,6 +183,58 @@ private:
         return result;
     }
 
+    static Napi::Object StatsToObject(Napi::Env env, const asar::Archive::Stats& stats) {
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("size", Napi::Number::New(env, stats.size));
+        result.Set("offset", Napi::Number::New(env, stats.offset));
+        result.Set("type", Napi::Number::New(env, static_cast<int>(stats.type)));
+        return result;
+    }
+
+    static Napi::Array PathsToArray(Napi::Env env, const std::vector<fs::path>& files) {
+        Napi::Array result = Napi::Array::New(env, files.size());
+        for (size_t i = 0; i < files.size(); ++i) {
+            result[i] = Napi::String::New(env, files[i].string());
+        }
+        return result;
+    }
+
+    // Creates a string from file content, as Latin-1 or else as UTF-8. ASCII
+    // is copied as is and other UTF-8 transcoded in a single pass, malformed
+    // UTF-8 is left to V8, which substitutes U+FFFD like Buffer#toString.
+    static Napi::Value DecodeString(Napi::Env env, const char* data, size_t size, bool latin1) {
+        napi_value result;
+        napi_status status;
+        std::u16string utf16;
+        if (latin1 || asar::IsAscii(data, size)) {
+            status = napi_create_string_latin1(env, data, size, &result);
+        } else if (asar::Utf8ToUtf16(data, size, &utf16)) {
+            status = napi_create_string_utf16(env, utf16.data(), utf16.size(), &result);
+        } else {
+            status = napi_create_string_utf8(env, data, size, &result);
+        }
+        NAPI_THROW_IF_FAILED(env, status, Napi::Value());
+        return Napi::Value(env, result);
+    }
+
+    Napi::Value GetFileInfo(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        std::string path_str = info[0].As<Napi::String>();
+        fs::path path(path_str);
+
+        asar::Archive::FileInfo file_info;
+        if (!archive_ || !archive_->GetFileInfo(path, &file_info)) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        return FileInfoToObject(env, file_info);
+    }
+
     Napi::Value Stat(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
 
@@ -114,12 +250,66 @@ private:
             return Napi::Boolean::New(env, false);
         }
 
-        Napi::Object result = Napi::Object::New(env);
-        result.Set("size", Napi::Number::New(env, stats.size));
-        result.Set("offset", Napi::Number::New(env, stats.offset));
-        result.Set("type", Napi::Number::New(env, static_cast<int>(stats.type)));
+        return StatsToObject(env, stats);
+    }
 
-        return result;
+    // Integer-returning variants of Stat for hot paths such as existsSync and
+    // module resolution, they create no objects.
+
+    // Returns the FileType of |path|, or 0 when it does not exist.
+    Napi::Value StatType(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            return Napi::Number::New(env, 0);
+        }
+
+        std::string path_str = info[0].As<Napi::String>();
+        asar::Archive::Stats stats;
+        if (!archive_ || !archive_->Stat(fs::path(path_str), &stats)) {
+            return Napi::Number::New(env, 0);
+        }
+        return Napi::Number::New(env, static_cast<int>(stats.type));
+    }
+
+    // Returns the size of |path|, or -1 when it does not exist.
+    Napi::Value Size(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            return Napi::Number::New(env, -1);
+        }
+
+        std::string path_str = info[0].As<Napi::String>();
+        asar::Archive::Stats stats;
+        if (!archive_ || !archive_->Stat(fs::path(path_str), &stats)) {
+            return Napi::Number::New(env, -1);
+        }
+        return Napi::Number::New(env, static_cast<double>(stats.size));
+    }
+
+    // Writes size and offset of |path| into the caller's Float64Array and
+    // returns the FileType, or 0 when it does not exist.
+    Napi::Value StatInto(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsTypedArray() ||
+            info[1].As<Napi::TypedArray>().TypedArrayType() != napi_float64_array ||
+            info[1].As<Napi::TypedArray>().ElementLength() < 2) {
+            Napi::TypeError::New(env, "Expected a path and a Float64Array of at least 2 elements").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        std::string path_str = info[0].As<Napi::String>();
+        asar::Archive::Stats stats;
+        if (!archive_ || !archive_->Stat(fs::path(path_str), &stats)) {
+            return Napi::Number::New(env, 0);
+        }
+
+        Napi::Float64Array values = info[1].As<Napi::Float64Array>();
+        values[0] = static_cast<double>(stats.size);
+        values[1] = static_cast<double>(stats.offset);
+        return Napi::Number::New(env, static_cast<int>(stats.type));
     }
 
     Napi::Value Readdir(const Napi::CallbackInfo& info) {
@@ -137,14 +327,206 @@ private:
             return Napi::Boolean::New(env, false);
         }
 
-        Napi::Array result = Napi::Array::New(env, files.size());
-        for (size_t i = 0; i < files.size(); ++i) {
-            result[i] = Napi::String::New(env, files[i].string());
+        return PathsToArray(env, files);
+    }
+
+    Napi::Value ReaddirWithTypes(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        std::string path_str = info[0].As<Napi::String>();
+        std::vector<asar::Archive::DirectoryEntry> entries;
+        if (!archive_ || !archive_->ReaddirWithTypes(fs::path(path_str), &entries)) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        Napi::Array names = Napi::Array::New(env, entries.size());
+        Napi::Uint8Array types = Napi::Uint8Array::New(env, entries.size());
+        for (size_t i = 0; i < entries.size(); ++i) {
+            names[i] = Napi::String::New(env, entries[i].name.data(), entries[i].name.size());
+            types[i] = static_cast<uint8_t>(entries[i].type);
+        }
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("names", names);
+        result.Set("types", types);
+        return result;
+    }
+
+    static uint32_t GetWalkMaxDepth(const Napi::CallbackInfo& info) {
+        if (info.Length() > 1 && info[1].IsObject()) {
+            Napi::Value value = info[1].As<Napi::Object>().Get("maxDepth");
+            if (value.IsNumber()) {
+                return value.As<Napi::Number>().Uint32Value();
+            }
+        }
+        return 0;
+    }
+
+    static Napi::Object WalkEntriesToObject(Napi::Env env, const std::vector<asar::Archive::WalkEntry>& entries) {
+        Napi::Array paths = Napi::Array::New(env, entries.size());
+        Napi::Uint8Array types = Napi::Uint8Array::New(env, entries.size());
+        for (size_t i = 0; i < entries.size(); ++i) {
+            paths[i] = Napi::String::New(env, entries[i].path);
+            types[i] = static_cast<uint8_t>(entries[i].type);
         }
 
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("paths", paths);
+        result.Set("types", types);
         return result;
     }
 
+    Napi::Value Walk(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        std::string path_str = info[0].As<Napi::String>();
+        std::vector<asar::Archive::WalkEntry> entries;
+        if (!archive_ || !archive_->Walk(fs::path(path_str), GetWalkMaxDepth(info), &entries)) {
+            return Napi::Boolean::New(env, false);
+        }
+        return WalkEntriesToObject(env, entries);
+    }
+
+    Napi::Value WalkAsync(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "Path must be a string").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        std::string path_str = info[0].As<Napi::String>();
+        uint32_t max_depth = GetWalkMaxDepth(info);
+        std::shared_ptr<asar::Archive> archive = archive_;
+        auto entries = std::make_shared<std::vector<asar::Archive::WalkEntry>>();
+        return PromiseWorker::Run(env,
+            [archive, path_str, max_depth, entries](std::string* error) {
+                if (!archive || !archive->Walk(fs::path(path_str), max_depth, entries.get())) {
+                    *error = "ENOTDIR, " + path_str + " is not a directory";
+                    return false;
+                }
+                return true;
+            },
+            [entries](Napi::Env env) -> Napi::Value {
+                return WalkEntriesToObject(env, *entries);
+            });
+    }
+
+    // Async variants of the queries above, run on the libuv thread pool and
+    // resolved with the same values. The archive is thread-safe after Init,
+    // each worker holds a reference so it outlives a collected wrapper.
+
+    static bool GetPathArgument(const Napi::CallbackInfo& info, std::string* path) {
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(info.Env(), "Path must be a string").ThrowAsJavaScriptException();
+            return false;
+        }
+        *path = info[0].As<Napi::String>();
+        return true;
+    }
+
+    Napi::Value GetFileInfoAsync(const Napi::CallbackInfo& info) {
+        std::string path_str;
+        if (!GetPathArgument(info, &path_str)) {
+            return info.Env().Undefined();
+        }
+
+        std::shared_ptr<asar::Archive> archive = archive_;
+        auto file_info = std::make_shared<std::optional<asar::Archive::FileInfo>>();
+        return PromiseWorker::Run(info.Env(),
+            [archive, path_str, file_info](std::string*) {
+                asar::Archive::FileInfo result;
+                if (archive && archive->GetFileInfo(fs::path(path_str), &result)) {
+                    *file_info = std::move(result);
+                }
+                return true;
+            },
+            [file_info](Napi::Env env) -> Napi::Value {
+                if (!*file_info) {
+                    return Napi::Boolean::New(env, false);
+                }
+                return FileInfoToObject(env, **file_info);
+            });
+    }
+
+    Napi::Value StatAsync(const Napi::CallbackInfo& info) {
+        std::string path_str;
+        if (!GetPathArgument(info, &path_str)) {
+            return info.Env().Undefined();
+        }
+
+        std::shared_ptr<asar::Archive> archive = archive_;
+        auto stats = std::make_shared<std::optional<asar::Archive::Stats>>();
+        return PromiseWorker::Run(info.Env(),
+            [archive, path_str, stats](std::string*) {
+                asar::Archive::Stats result;
+                if (archive && archive->Stat(fs::path(path_str), &result)) {
+                    *stats = std::move(result);
+                }
+                return true;
+            },
+            [stats](Napi::Env env) -> Napi::Value {
+                if (!*stats) {
+                    return Napi::Boolean::New(env, false);
+                }
+                return StatsToObject(env, **stats);
+            });
+    }
+
+    Napi::Value ReaddirAsync(const Napi::CallbackInfo& info) {
+        std::string path_str;
+        if (!GetPathArgument(info, &path_str)) {
+            return info.Env().Undefined();
+        }
+
+        std::shared_ptr<asar::Archive> archive = archive_;
+        auto files = std::make_shared<std::vector<fs::path>>();
+        auto found = std::make_shared<bool>(false);
+        return PromiseWorker::Run(info.Env(),
+            [archive, path_str, files, found](std::string*) {
+                *found = archive && archive->Readdir(fs::path(path_str), files.get());
+                return true;
+            },
+            [files, found](Napi::Env env) -> Napi::Value {
+                if (!*found) {
+                    return Napi::Boolean::New(env, false);
+                }
+                return PathsToArray(env, *files);
+            });
+    }
+
+    Napi::Value RealpathAsync(const Napi::CallbackInfo& info) {
+        std::string path_str;
+        if (!GetPathArgument(info, &path_str)) {
+            return info.Env().Undefined();
+        }
+
+        std::shared_ptr<asar::Archive> archive = archive_;
+        auto realpath = std::make_shared<std::optional<fs::path>>();
+        return PromiseWorker::Run(info.Env(),
+            [archive, path_str, realpath](std::string*) {
+                fs::path result;
+                if (archive && archive->Realpath(fs::path(path_str), &result)) {
+                    *realpath = std::move(result);
+                }
+                return true;
+            },
+            [realpath](Napi::Env env) -> Napi::Value {
+                if (!*realpath) {
+                    return Napi::Boolean::New(env, false);
+                }
+                return Napi::String::New(env, (*realpath)->string());
+            });
+    }
+
     Napi::Value Realpath(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
 
@@ -163,7 +545,7 @@ private:
         return Napi::String::New(env, realpath.string());
     }
 
-    Napi::Value CopyFileOut(const Napi::CallbackInfo& info) {
+    Napi::Value Read(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
 
         if (info.Length() < 1 || !info[0].IsString()) {
@@ -173,39 +555,816 @@ private:
         std::string path_str = info[0].As<Napi::String>();
         fs::path path(path_str);
 
-        fs::path new_path;
-        if (!archive_ || !archive_->CopyFileOut(path, &new_path)) {
+        asar::Archive::FileInfo file_info;
+        if (!archive_ || !archive_->GetFileInfo(path, &file_info) || file_info.unpacked) {
             return Napi::Boolean::New(env, false);
         }
 
-        return Napi::String::New(env, new_path.string());
+        uint64_t position = 0;
+        if (info.Length() > 1 && info[1].IsNumber()) {
+            position = info[1].As<Napi::Number>().Int64Value();
+        }
+        if (position > file_info.size) {
+            return Napi::Boolean::New(env, false);
+        }
+        size_t length = file_info.size - position;
+        if (info.Length() > 2 && info[2].IsNumber()) {
+            length = std::min<size_t>(length, info[2].As<Napi::Number>().Int64Value());
+        }
+
+        // With an encoding the content is decoded straight into a string.
+        std::optional<bool> latin1;
+        if (info.Length() > 3 && info[3].IsString()) {
+            std::string encoding = info[3].As<Napi::String>();
+            if (encoding == "utf8" || encoding == "utf-8") {
+                latin1 = false;
+            } else if (encoding == "latin1" || encoding == "binary") {
+                latin1 = true;
+            } else {
+                Napi::TypeError::New(env, "Unsupported encoding: " + encoding).ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+        }
+
+        Napi::Buffer<char> buffer;
+        std::unique_ptr<char[]> text;
+        char* out;
+        if (latin1) {
+            text.reset(new char[length]);
+            out = text.get();
+        } else {
+            buffer = Napi::Buffer<char>::New(env, length);
+            out = buffer.Data();
+        }
+
+        asar::Archive::ReadResult result = (position == 0 && length == file_info.size)
+            ? archive_->ReadFile(file_info, out)
+            : archive_->ReadFileRange(file_info, position, &length, out);
+
+        if (result == asar::Archive::ReadResult::kIntegrityFailed) {
+            Napi::Error::New(env, "ASAR Integrity Violation: got a hash mismatch for " + path_str)
+                .ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        if (result != asar::Archive::ReadResult::kSuccess) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        if (latin1) {
+            return DecodeString(env, text.get(), length, *latin1);
+        }
+        return buffer;
     }
 
-    Napi::Value GetFD(const Napi::CallbackInfo& info) {
+    // Reads a packed file as a string without going through a Buffer. ASCII
+    // content, which is what most module sources are, is created as a
+    // one-byte string straight from the read buffer. Built for N-API 10,
+    // where external strings are stable, the buffer is handed to V8 instead
+    // of being copied into its heap. Either way the string owns its copy, a
+    // later change to the archive file cannot reach it.
+    Napi::Value ReadSource(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
 
-        int fd = archive_ ? archive_->GetUnsafeFD() : -1;
-        return Napi::Number::New(env, fd);
+        if (info.Length() < 1 || !info[0].IsString()) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        std::string path_str = info[0].As<Napi::String>();
+        fs::path path(path_str);
+
+        asar::Archive::FileInfo file_info;
+        if (!archive_ || !archive_->GetFileInfo(path, &file_info) || file_info.unpacked) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        const size_t size = static_cast<size_t>(file_info.size);
+        std::unique_ptr<char[]> data(new char[size]);
+        asar::Archive::ReadResult read_result = archive_->ReadFile(file_info, data.get());
+        if (read_result == asar::Archive::ReadResult::kIntegrityFailed) {
+            Napi::Error::New(env, "ASAR Integrity Violation: got a hash mismatch for " + path_str)
+                .ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        if (read_result != asar::Archive::ReadResult::kSuccess) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        if (!asar::IsAscii(data.get(), size)) {
+            return DecodeString(env, data.get(), size, false);
+        }
+
+        napi_value result;
+#if NAPI_VERSION >= 10
+        // The finalizer frees the content, also right away when V8 copied it.
+        char* chars = data.release();
+        bool copied = false;
+        napi_status status = node_api_create_external_string_latin1(
+            env, chars, size,
+            [](napi_env, void* chars, void*) {
+                delete[] static_cast<char*>(chars);
+            },
+            nullptr, &result, &copied);
+        if (status != napi_ok) {
+            delete[] chars;
+            NAPI_THROW_IF_FAILED(env, status, Napi::Value());
+        }
+#else
+        napi_status status = napi_create_string_latin1(env, data.get(), size, &result);
+        NAPI_THROW_IF_FAILED(env, status, Napi::Value());
+#endif
+        return Napi::String(env, result);
     }
 
-    Napi::Value GetArchivePath(const Napi::CallbackInfo& info) {
+    // Returns an ArrayBuffer over a mapping of one packed file, see
+    // Archive::MapFile. The mapping is released with the ArrayBuffer. Where
+    // external buffers are not allowed the content is copied instead.
+    Napi::Value MapEntry(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
-        return Napi::String::New(env, archive_ ? archive_->path().string() : "");
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        std::string path_str = info[0].As<Napi::String>();
+        fs::path path(path_str);
+
+        asar::Archive::FileInfo file_info;
+        if (!archive_ || !archive_->GetFileInfo(path, &file_info) || file_info.unpacked) {
+            return Napi::Boolean::New(env, false);
+        }
+        if (file_info.size == 0) {
+            return Napi::ArrayBuffer::New(env, 0);
+        }
+
+        std::unique_ptr<asar::MappedFile> mapped = archive_->MapFile(file_info);
+        if (!mapped) {
+            return Napi::Boolean::New(env, false);
+        }
+        if (!archive_->ValidateFileContent(file_info, std::string_view(mapped->data(), mapped->size()))) {
+            Napi::Error::New(env, "ASAR Integrity Violation: got a hash mismatch for " + path_str)
+                .ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        napi_value result;
+        napi_status status = napi_create_external_arraybuffer(
+            env, mapped->mutable_data(), mapped->size(),
+            [](napi_env, void*, void* hint) {
+                delete static_cast<asar::MappedFile*>(hint);
+            },
+            mapped.get(), &result);
+        if (status == napi_ok) {
+            mapped.release();
+            return Napi::ArrayBuffer(env, result);
+        }
+
+        Napi::ArrayBuffer buffer = Napi::ArrayBuffer::New(env, mapped->size());
+        memcpy(buffer.Data(), mapped->data(), mapped->size());
+        return buffer;
     }
-};
 
-// Split path function
-Napi::Value SplitPath(const Napi::CallbackInfo& info) {
-    Napi::Env env = info.Env();
+    Napi::Value ValidateIntegrity(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
 
-    if (info.Length() < 1 || !info[0].IsString()) {
-        return Napi::Boolean::New(env, false);
+        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsBuffer()) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        std::string path_str = info[0].As<Napi::String>();
+        fs::path path(path_str);
+
+        asar::Archive::FileInfo file_info;
+        if (!archive_ || !archive_->GetFileInfo(path, &file_info)) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        Napi::Buffer<char> buffer = info[1].As<Napi::Buffer<char>>();
+        std::string_view content(buffer.Data(), buffer.Length());
+        return Napi::Boolean::New(env, archive_->ValidateFileContent(file_info, content));
     }
 
-    std::string path_str = info[0].As<Napi::String>();
-    fs::path path(path_str);
+    static Napi::Object VerifyEventToObject(Napi::Env env, const asar::Archive::VerifyEvent& event) {
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("verifiedFiles", Napi::Number::New(env, static_cast<double>(event.verified_files)));
+        result.Set("failedFiles", Napi::Number::New(env, static_cast<double>(event.failed_files)));
+        result.Set("totalFiles", Napi::Number::New(env, static_cast<double>(event.total_files)));
+        result.Set("verifiedBytes", Napi::Number::New(env, static_cast<double>(event.verified_bytes)));
+        result.Set("totalBytes", Napi::Number::New(env, static_cast<double>(event.total_bytes)));
+        if (!event.failed_path.empty()) {
+            result.Set("failedPath", Napi::String::New(env, event.failed_path));
+        }
+        return result;
+    }
+
+    // Validates all files on a background thread, progress and failures are
+    // posted to the optional callback, the returned promise resolves with the
+    // final counts.
+    Napi::Value VerifyAll(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        uint32_t threads = 0;
+        Napi::Function callback;
+        for (size_t i = 0; i < info.Length(); ++i) {
+            if (info[i].IsFunction()) {
+                callback = info[i].As<Napi::Function>();
+            } else if (info[i].IsObject()) {
+                Napi::Value value = info[i].As<Napi::Object>().Get("threads");
+                if (value.IsNumber()) {
+                    threads = value.As<Napi::Number>().Uint32Value();
+                }
+            }
+        }
+        if (callback.IsEmpty()) {
+            callback = Napi::Function::New(env, [](const Napi::CallbackInfo&) {});
+        }
+
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        if (!archive_) {
+            deferred.Reject(Napi::Error::New(env, "Archive is not initialized").Value());
+            return deferred.Promise();
+        }
+
+        Napi::ThreadSafeFunction tsfn = Napi::ThreadSafeFunction::New(env, callback, "asarVerifyAll", 0, 1);
+        std::shared_ptr<asar::Archive> archive = archive_;
+        std::thread([tsfn, archive, threads, deferred]() mutable {
+            asar::Archive::VerifyEvent last;
+            archive->VerifyAll(threads, [&](const asar::Archive::VerifyEvent& event) {
+                last = event;
+                tsfn.BlockingCall(new asar::Archive::VerifyEvent(event),
+                    [](Napi::Env env, Napi::Function fn, asar::Archive::VerifyEvent* event) {
+                        fn.Call({VerifyEventToObject(env, *event)});
+                        delete event;
+                    });
+            });
+            last.failed_path.clear();
+            tsfn.BlockingCall(new asar::Archive::VerifyEvent(last),
+                [deferred](Napi::Env env, Napi::Function, asar::Archive::VerifyEvent* event) {
+                    deferred.Resolve(VerifyEventToObject(env, *event));
+                    delete event;
+                });
+            tsfn.Release();
+        }).detach();
+
+        return deferred.Promise();
+    }
+
+    Napi::Value GetIntegrityStats(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        asar::VerifiedSet::Counters counters;
+        if (archive_) {
+            counters = archive_->IntegrityCounters();
+        }
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("verifiedFiles", Napi::Number::New(env, static_cast<double>(counters.verified_files)));
+        result.Set("hashedBytes", Napi::Number::New(env, static_cast<double>(counters.hashed_bytes)));
+        result.Set("hashMs", Napi::Number::New(env, counters.hash_ns / 1e6));
+        result.Set("skippedReads", Napi::Number::New(env, static_cast<double>(counters.skipped_reads)));
+        result.Set("skippedBytes", Napi::Number::New(env, static_cast<double>(counters.skipped_bytes)));
+        result.Set("savedMs", Napi::Number::New(env, counters.saved_ns / 1e6));
+        return result;
+    }
+
+    Napi::Value CopyFileOut(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        std::string path_str = info[0].As<Napi::String>();
+        fs::path path(path_str);
+
+        fs::path new_path;
+        if (!archive_ || !archive_->CopyFileOut(path, &new_path)) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        return Napi::String::New(env, new_path.string());
+    }
+
+    Napi::Value AcquireFileOut(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        std::string path_str = info[0].As<Napi::String>();
+        fs::path path(path_str);
+
+        fs::path new_path;
+        std::shared_ptr<asar::ScopedTemporaryFile> handle;
+        if (!archive_ || !archive_->AcquireFileOut(path, &new_path, &handle)) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        if (handle) {
+            file_out_handles_[path_str].push_back(std::move(handle));
+        }
+        return Napi::String::New(env, new_path.string());
+    }
+
+    Napi::Value ReleaseFileOut(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        std::string path_str = info[0].As<Napi::String>();
+        auto it = file_out_handles_.find(path_str);
+        if (it == file_out_handles_.end()) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        it->second.pop_back();
+        if (it->second.empty()) {
+            file_out_handles_.erase(it);
+        }
+        return Napi::Boolean::New(env, true);
+    }
+
+    Napi::Value SetFileOutLimits(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsObject()) {
+            Napi::TypeError::New(env, "Limits must be an object").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        Napi::Object limits = info[0].As<Napi::Object>();
+        Napi::Value max_bytes = limits.Get("maxBytes");
+        Napi::Value max_entries = limits.Get("maxEntries");
+
+        if (archive_) {
+            archive_->SetFileOutLimits(
+                max_bytes.IsNumber() ? max_bytes.As<Napi::Number>().Int64Value() : 0,
+                max_entries.IsNumber() ? max_entries.As<Napi::Number>().Uint32Value() : 0);
+        }
+        return env.Undefined();
+    }
+
+    static uint32_t GetExtractConcurrency(const Napi::CallbackInfo& info) {
+        if (info.Length() > 2 && info[2].IsObject()) {
+            Napi::Value value = info[2].As<Napi::Object>().Get("concurrency");
+            if (value.IsNumber()) {
+                return value.As<Napi::Number>().Uint32Value();
+            }
+        }
+        return 0;
+    }
+
+    static Napi::Object ExtractStatsToObject(Napi::Env env, const asar::Archive::ExtractStats& stats) {
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("files", Napi::Number::New(env, static_cast<double>(stats.files)));
+        result.Set("links", Napi::Number::New(env, static_cast<double>(stats.links)));
+        result.Set("directories", Napi::Number::New(env, static_cast<double>(stats.directories)));
+        result.Set("bytes", Napi::Number::New(env, static_cast<double>(stats.bytes)));
+        result.Set("elapsedMs", Napi::Number::New(env, stats.elapsed_ms));
+        result.Set("bytesPerSecond", Napi::Number::New(env, stats.bytes_per_second));
+        return result;
+    }
+
+    Napi::Value ExtractTree(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+            Napi::TypeError::New(env, "Path and destination must be strings").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        std::string path_str = info[0].As<Napi::String>();
+        std::string dest_str = info[1].As<Napi::String>();
+        uint32_t concurrency = GetExtractConcurrency(info);
+
+        asar::Archive::ExtractStats stats;
+        if (!archive_ || !archive_->ExtractTree(fs::path(path_str), fs::path(dest_str), concurrency, &stats)) {
+            std::string message = stats.error.empty() ? "Failed to extract " + path_str : stats.error;
+            Napi::Error::New(env, message).ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        return ExtractStatsToObject(env, stats);
+    }
+
+    // Same as ExtractTree, but the extraction runs on the libuv thread pool.
+    Napi::Value ExtractTreeAsync(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+            Napi::TypeError::New(env, "Path and destination must be strings").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        std::string path_str = info[0].As<Napi::String>();
+        std::string dest_str = info[1].As<Napi::String>();
+        uint32_t concurrency = GetExtractConcurrency(info);
+
+        std::shared_ptr<asar::Archive> archive = archive_;
+        auto stats = std::make_shared<asar::Archive::ExtractStats>();
+        return PromiseWorker::Run(env,
+            [archive, path_str, dest_str, concurrency, stats](std::string* error) {
+                if (!archive || !archive->ExtractTree(fs::path(path_str), fs::path(dest_str), concurrency, stats.get())) {
+                    *error = stats->error.empty() ? "Failed to extract " + path_str : stats->error;
+                    return false;
+                }
+                return true;
+            },
+            [stats](Napi::Env env) -> Napi::Value {
+                return ExtractStatsToObject(env, *stats);
+            });
+    }
+
+    Napi::Value GetFD(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (!archive_) {
+            return Napi::Number::New(env, -1);
+        }
+
+        // Files of overlay layers are in the fd of their layer.
+        int fd;
+        if (info.Length() > 0 && info[0].IsString()) {
+            std::string path_str = info[0].As<Napi::String>();
+            asar::Archive::FileInfo file_info;
+            if (!archive_->GetFileInfo(fs::path(path_str), &file_info)) {
+                return Napi::Number::New(env, -1);
+            }
+            fd = archive_->GetUnsafeFD(file_info);
+        } else {
+            fd = archive_->GetUnsafeFD();
+        }
+
+        // Keep the archive, which also owns its layers, open until released
+        // even if a reload replaces it meanwhile.
+        if (fd >= 0) {
+            FdHold& hold = fd_holds_[fd];
+            if (!hold.archive) {
+                hold.archive = archive_;
+            }
+            ++hold.count;
+        }
+        return Napi::Number::New(env, fd);
+    }
+
+    Napi::Value ReleaseFD(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsNumber()) {
+            return Napi::Boolean::New(env, false);
+        }
+
+        auto it = fd_holds_.find(info[0].As<Napi::Number>().Int32Value());
+        if (it == fd_holds_.end()) {
+            return Napi::Boolean::New(env, false);
+        }
+        if (--it->second.count == 0) {
+            fd_holds_.erase(it);
+        }
+        return Napi::Boolean::New(env, true);
+    }
+
+    // Switches to the current archive at the same path after a reload,
+    // returns whether it changed. Queries in flight keep the old archive.
+    Napi::Value Refresh(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (!archive_ || !asar::IsArchiveReloadEnabled()) {
+            return Napi::Boolean::New(env, false);
+        }
+        std::shared_ptr<asar::Archive> current = asar::GetOrCreateAsarArchive(archive_->path());
+        if (!current || current == archive_) {
+            return Napi::Boolean::New(env, false);
+        }
+        archive_ = std::move(current);
+        return Napi::Boolean::New(env, true);
+    }
+
+    Napi::Value GetMemoryUsage(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (!archive_) {
+            return env.Null();
+        }
+        return MemoryUsageToObject(env, *archive_);
+    }
+
+    Napi::Value GetArchivePath(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        return Napi::String::New(env, archive_ ? archive_->path().string() : "");
+    }
+};
+
+Napi::Value SetIntegrityValidationEnabled(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    asar::SetIntegrityValidationEnabled(info.Length() > 0 && info[0].ToBoolean().Value());
+    return env.Undefined();
+}
+
+Napi::Value RegisterArchive(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Path must be a string").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::string path_str = info[0].As<Napi::String>();
+    asar::RegisterArchiveRoot(path_str);
+    return env.Undefined();
+}
+
+Napi::Value ConfigureDirectoryCache(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Object options = info[0].As<Napi::Object>();
+    Napi::Value max_entries = options.Get("maxEntries");
+    Napi::Value ttl_ms = options.Get("ttlMs");
+    Napi::Value watch = options.Get("watch");
+
+    asar::DirectoryCache::GetInstance().Configure(
+        max_entries.IsNumber() ? max_entries.As<Napi::Number>().Uint32Value() : 8192,
+        std::chrono::milliseconds(ttl_ms.IsNumber() ? ttl_ms.As<Napi::Number>().Int64Value() : 0),
+        watch.IsBoolean() ? watch.As<Napi::Boolean>().Value() : true);
+    return env.Undefined();
+}
+
+Napi::Value GetDirectoryCacheStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    asar::DirectoryCache::Counters counters = asar::DirectoryCache::GetInstance().GetCounters();
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("hits", Napi::Number::New(env, static_cast<double>(counters.hits)));
+    result.Set("misses", Napi::Number::New(env, static_cast<double>(counters.misses)));
+    result.Set("evictions", Napi::Number::New(env, static_cast<double>(counters.evictions)));
+    result.Set("invalidations", Napi::Number::New(env, static_cast<double>(counters.invalidations)));
+    result.Set("contentions", Napi::Number::New(env, static_cast<double>(counters.contentions)));
+    result.Set("unwatched", Napi::Number::New(env, static_cast<double>(counters.unwatched)));
+    result.Set("entries", Napi::Number::New(env, static_cast<double>(counters.entries)));
+    return result;
+}
+
+Napi::Value ConfigureArchiveReload(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Object options = info[0].As<Napi::Object>();
+    Napi::Value enabled = options.Get("enabled");
+    Napi::Value check_interval_ms = options.Get("checkIntervalMs");
+    Napi::Value watch = options.Get("watch");
+
+    asar::SetArchiveReloadOptions(
+        enabled.IsBoolean() ? enabled.As<Napi::Boolean>().Value() : true,
+        std::chrono::milliseconds(check_interval_ms.IsNumber() ? check_interval_ms.As<Napi::Number>().Int64Value() : 1000),
+        watch.IsBoolean() ? watch.As<Napi::Boolean>().Value() : true);
+    return env.Undefined();
+}
+
+Napi::Value GetArchiveReloadStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
 
     Napi::Object result = Napi::Object::New(env);
+    result.Set("enabled", Napi::Boolean::New(env, asar::IsArchiveReloadEnabled()));
+    result.Set("reloads", Napi::Number::New(env, static_cast<double>(asar::GetArchiveReloadCount())));
+    return result;
+}
+
+Napi::Value SetPathIndexEnabled(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    asar::SetPathIndexEnabled(info.Length() > 0 && info[0].ToBoolean().Value());
+    return env.Undefined();
+}
+
+// internalModuleStat for paths in indexed archives: 1 for directories, 0 for
+// files and -ENOENT for missing paths. False when the path is not inside an
+// indexed archive or is a link, which are left to the regular lookup.
+Napi::Value IndexedModuleStat(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString()) {
+        return Napi::Boolean::New(env, false);
+    }
+
+    std::string path_str = info[0].As<Napi::String>();
+    asar::Archive::FileType type;
+    switch (asar::PathIndex::GetInstance().Find(path_str, &type)) {
+        case asar::PathIndex::Result::kNotFound:
+            return Napi::Number::New(env, -34);
+        case asar::PathIndex::Result::kFound:
+            if (type != asar::Archive::FileType::kLink) {
+                return Napi::Number::New(env, type == asar::Archive::FileType::kDirectory ? 1 : 0);
+            }
+            break;
+        case asar::PathIndex::Result::kNotIndexed:
+            break;
+    }
+    return Napi::Boolean::New(env, false);
+}
+
+Napi::Value GetPathIndexStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    asar::PathIndex::Counters counters = asar::PathIndex::GetInstance().GetCounters();
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("enabled", Napi::Boolean::New(env, asar::PathIndex::GetInstance().enabled()));
+    result.Set("archives", Napi::Number::New(env, static_cast<double>(counters.archives)));
+    result.Set("entries", Napi::Number::New(env, static_cast<double>(counters.entries)));
+    result.Set("bytes", Napi::Number::New(env, static_cast<double>(counters.bytes)));
+    return result;
+}
+
+Napi::Value SetArchiveLayers(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsArray()) {
+        Napi::TypeError::New(env, "Expected a path and an array of layer paths").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::string path_str = info[0].As<Napi::String>();
+    Napi::Array array = info[1].As<Napi::Array>();
+    std::vector<fs::path> layers;
+    for (uint32_t i = 0; i < array.Length(); ++i) {
+        Napi::Value layer = array.Get(i);
+        if (!layer.IsString()) {
+            Napi::TypeError::New(env, "Layer paths must be strings").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        layers.emplace_back(layer.As<Napi::String>().Utf8Value());
+    }
+    asar::SetArchiveLayers(fs::path(path_str), std::move(layers));
+    return env.Undefined();
+}
+
+Napi::Value UnloadArchive(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Path must be a string").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::string path_str = info[0].As<Napi::String>();
+    std::shared_ptr<asar::Archive> archive = asar::UnloadAsarArchive(fs::path(path_str));
+    if (!archive) {
+        return Napi::Boolean::New(env, false);
+    }
+    // What is released along with the last reference.
+    return MemoryUsageToObject(env, *archive);
+}
+
+Napi::Value UnloadIdleArchives(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsArray()) {
+        Napi::TypeError::New(env, "Used archives must be an array").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Array array = info[0].As<Napi::Array>();
+    std::vector<fs::path> used;
+    used.reserve(array.Length());
+    for (uint32_t i = 0; i < array.Length(); ++i) {
+        Napi::Value path = array.Get(i);
+        if (!path.IsString()) {
+            Napi::TypeError::New(env, "Archive paths must be strings").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        used.emplace_back(path.As<Napi::String>().Utf8Value());
+    }
+
+    std::vector<std::string> unloaded = asar::UnloadIdleAsarArchives(used);
+    Napi::Array result = Napi::Array::New(env, unloaded.size());
+    for (size_t i = 0; i < unloaded.size(); ++i) {
+        result[i] = Napi::String::New(env, unloaded[i]);
+    }
+    return result;
+}
+
+Napi::Value GetArchiveMemoryStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    std::vector<std::shared_ptr<asar::Archive>> archives = asar::GetOpenedAsarArchives();
+    Napi::Array list = Napi::Array::New(env, archives.size());
+    for (size_t i = 0; i < archives.size(); ++i) {
+        list[i] = MemoryUsageToObject(env, *archives[i]);
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("archives", list);
+    result.Set("pendingUnloads", Napi::Number::New(env, static_cast<double>(asar::GetPendingUnloadCount())));
+    return result;
+}
+
+Napi::Value AddMount(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+        Napi::TypeError::New(env, "Mount point and target must be strings").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::string mount_point = info[0].As<Napi::String>();
+    std::string target = info[1].As<Napi::String>();
+    asar::MountTable::GetInstance().Add(mount_point, target);
+    return env.Undefined();
+}
+
+Napi::Value RemoveMount(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Mount point must be a string").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::string mount_point = info[0].As<Napi::String>();
+    return Napi::Boolean::New(env, asar::MountTable::GetInstance().Remove(mount_point));
+}
+
+Napi::Value ResolveMount(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString()) {
+        return env.Null();
+    }
+
+    std::string path_str = info[0].As<Napi::String>();
+    std::optional<std::string> resolved = asar::MountTable::GetInstance().Resolve(path_str);
+    if (!resolved) {
+        return env.Null();
+    }
+    return Napi::String::New(env, *resolved);
+}
+
+Napi::Value GetMounts(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    std::vector<asar::MountTable::Mount> mounts = asar::MountTable::GetInstance().GetMounts();
+    Napi::Array result = Napi::Array::New(env, mounts.size());
+    for (size_t i = 0; i < mounts.size(); ++i) {
+        Napi::Object mount = Napi::Object::New(env);
+        mount.Set("mountPoint", Napi::String::New(env, mounts[i].mount_point));
+        mount.Set("target", Napi::String::New(env, mounts[i].target));
+        result.Set(static_cast<uint32_t>(i), mount);
+    }
+    return result;
+}
+
+// Split a path inside a registered archive, without falling back to disk
+// probing. Returns false for any other path.
+Napi::Value SplitArchivePath(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString()) {
+        return Napi::Boolean::New(env, false);
+    }
+
+    std::string path_str = info[0].As<Napi::String>();
+    std::string_view asar_view, file_view;
+    if (!asar::SplitArchivePath(path_str, &asar_view, &file_view, true)) {
+        return Napi::Boolean::New(env, false);
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("isAsar", Napi::Boolean::New(env, true));
+    result.Set("asarPath", Napi::String::New(env, asar_view.data(), asar_view.size()));
+    result.Set("filePath", Napi::String::New(env, file_view.data(), file_view.size()));
+    return result;
+}
+
+// Split path function
+Napi::Value SplitPath(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString()) {
+        return Napi::Boolean::New(env, false);
+    }
+
+    std::string path_str = info[0].As<Napi::String>();
+    Napi::Object result = Napi::Object::New(env);
+
+    // Registered archives are split lexically without touching the disk.
+    std::string_view asar_view, file_view;
+    if (asar::SplitArchivePath(path_str, &asar_view, &file_view, true)) {
+        result.Set("isAsar", Napi::Boolean::New(env, true));
+        result.Set("asarPath", Napi::String::New(env, asar_view.data(), asar_view.size()));
+        result.Set("filePath", Napi::String::New(env, file_view.data(), file_view.size()));
+        return result;
+    }
+
+    fs::path path(path_str);
     fs::path asar_path, file_path;
 
     if (asar::GetAsarArchivePath(path, &asar_path, &file_path, true)) {
@@ -223,6 +1382,24 @@ Napi::Value SplitPath(const Napi::CallbackInfo& info) {
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
     ArchiveWrapper::Init(env, exports);
     exports.Set("splitPath", Napi::Function::New(env, SplitPath));
+    exports.Set("splitArchivePath", Napi::Function::New(env, SplitArchivePath));
+    exports.Set("registerArchive", Napi::Function::New(env, RegisterArchive));
+    exports.Set("configureDirectoryCache", Napi::Function::New(env, ConfigureDirectoryCache));
+    exports.Set("getDirectoryCacheStats", Napi::Function::New(env, GetDirectoryCacheStats));
+    exports.Set("configureArchiveReload", Napi::Function::New(env, ConfigureArchiveReload));
+    exports.Set("getArchiveReloadStats", Napi::Function::New(env, GetArchiveReloadStats));
+    exports.Set("unloadArchive", Napi::Function::New(env, UnloadArchive));
+    exports.Set("unloadIdleArchives", Napi::Function::New(env, UnloadIdleArchives));
+    exports.Set("setArchiveLayers", Napi::Function::New(env, SetArchiveLayers));
+    exports.Set("setPathIndexEnabled", Napi::Function::New(env, SetPathIndexEnabled));
+    exports.Set("indexedModuleStat", Napi::Function::New(env, IndexedModuleStat));
+    exports.Set("getPathIndexStats", Napi::Function::New(env, GetPathIndexStats));
+    exports.Set("getArchiveMemoryStats", Napi::Function::New(env, GetArchiveMemoryStats));
+    exports.Set("addMount", Napi::Function::New(env, AddMount));
+    exports.Set("removeMount", Napi::Function::New(env, RemoveMount));
+    exports.Set("resolveMount", Napi::Function::New(env, ResolveMount));
+    exports.Set("getMounts", Napi::Function::New(env, GetMounts));
+    exports.Set("setIntegrityValidationEnabled", Napi::Function::New(env, SetIntegrityValidationEnabled));
     return exports;
 }
 
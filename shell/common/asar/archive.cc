@@ -5,8 +5,11 @@
 #include "archive.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <fcntl.h> // For open()
 #include <unistd.h> // For read(), close()
@@ -14,6 +17,7 @@
 #include <optional>
 #include <string>
 #include <string_view>
+#include <tuple>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -29,6 +33,8 @@
 #include <sys/stat.h>
 #endif
 
+#include "./asar_util.h"
+#include "./integrity.h"
 #include "./logger.h"
 #include "./scoped_temporary_file.h"
 
@@ -44,6 +50,81 @@ const char kSeparators[] = "/";
 
 const nlohmann::json* GetNodeFromPath(std::string path, const nlohmann::json& root);
 
+// Bounds the links followed for one lookup in a binary header.
+constexpr uint32_t kMaxLinkDepth = 40;
+
+// Key tagging file nodes merged in from an overlay layer with the layer.
+const char kLayerKey[] = "layer";
+
+const char kWhiteoutPrefix[] = ".wh.";
+const char kOpaqueWhiteout[] = ".wh..wh..opq";
+
+bool IsWhiteout(const std::string& name) {
+  return name.compare(0, sizeof(kWhiteoutPrefix) - 1, kWhiteoutPrefix) == 0;
+}
+
+bool IsDirectoryNode(const nlohmann::json& node) {
+  return node.contains("files") && !node.contains("link");
+}
+
+void TagLayer(nlohmann::json* node, uint32_t layer) {
+  if (node->contains("files") && (*node)["files"].is_object()) {
+    for (auto& [name, child] : (*node)["files"].items())
+      TagLayer(&child, layer);
+  } else if (!node->contains("link")) {
+    (*node)[kLayerKey] = layer;
+  }
+}
+
+// Merges the directory |upper| of overlay |layer| into |lower|.
+void MergeDirectory(nlohmann::json* lower, const nlohmann::json& upper, uint32_t layer) {
+  if (!upper.contains("files") || !upper["files"].is_object())
+    return;
+  const nlohmann::json& upper_files = upper["files"];
+  nlohmann::json& files = (*lower)["files"];
+  if (!files.is_object() || upper_files.contains(kOpaqueWhiteout))
+    files = nlohmann::json::object();
+
+  // Whiteouts apply to the layers below only, a layer may replace what it
+  // hides.
+  for (const auto& [name, child] : upper_files.items()) {
+    if (IsWhiteout(name) && name != kOpaqueWhiteout)
+      files.erase(name.substr(sizeof(kWhiteoutPrefix) - 1));
+  }
+  for (const auto& [name, child] : upper_files.items()) {
+    if (IsWhiteout(name))
+      continue;
+    auto it = files.find(name);
+    if (it != files.end() && IsDirectoryNode(*it) && IsDirectoryNode(child)) {
+      MergeDirectory(&*it, child, layer);
+      continue;
+    }
+    nlohmann::json copy = child;
+    TagLayer(&copy, layer);
+    files[name] = std::move(copy);
+  }
+}
+
+// Rough heap usage of a parsed JSON value, counting one allocation per
+// container node and the capacity of strings.
+uint64_t EstimateJsonBytes(const nlohmann::json& value) {
+  uint64_t bytes = sizeof(nlohmann::json);
+  if (value.is_object()) {
+    bytes += sizeof(nlohmann::json::object_t);
+    for (const auto& [key, child] : value.items()) {
+      // Tree node: three links and a color next to the key and value.
+      bytes += 4 * sizeof(void*) + sizeof(std::string) + key.capacity() + EstimateJsonBytes(child);
+    }
+  } else if (value.is_array()) {
+    bytes += sizeof(nlohmann::json::array_t);
+    for (const auto& child : value)
+      bytes += EstimateJsonBytes(child);
+  } else if (value.is_string()) {
+    bytes += sizeof(std::string) + value.get_ref<const std::string&>().capacity();
+  }
+  return bytes;
+}
+
 // Gets the "files" from "dir".
 const nlohmann::json* GetFilesNode(const nlohmann::json& root, const nlohmann::json& dir) {
   // Test for symbol linked directory.
@@ -161,6 +242,102 @@ bool FillFileInfoWithNode(Archive::FileInfo* info,
   return true;
 }
 
+// Whether |path| names |base| or something below it, lexically. An
+// absolute |path| is only within an absolute |base|.
+bool IsWithin(const fs::path& path, const fs::path& base) {
+  const fs::path relative = path.lexically_normal().lexically_relative(base.lexically_normal());
+  return !relative.empty() && *relative.begin() != "..";
+}
+
+struct ExtractEntry {
+  fs::path path;
+  const nlohmann::json* node;
+  // The record in a binary header, when |node| is null.
+  uint32_t index = 0U;
+};
+
+// Collects the descendants of |dir| into |dirs|, |links| and |files|, the
+// paths are relative to |dir|.
+void CollectTreeEntries(const nlohmann::json& root,
+                        const nlohmann::json& dir,
+                        const fs::path& prefix,
+                        std::vector<ExtractEntry>* dirs,
+                        std::vector<ExtractEntry>* links,
+                        std::vector<ExtractEntry>* files) {
+  const nlohmann::json* files_node = GetFilesNode(root, dir);
+  if (!files_node)
+    return;
+
+  for (const auto& [name, child] : files_node->items()) {
+    fs::path child_path = prefix / name;
+    if (child.contains("link")) {
+      links->push_back({child_path, &child});
+    } else if (child.contains("files")) {
+      dirs->push_back({child_path, &child});
+      CollectTreeEntries(root, child, child_path, dirs, links, files);
+    } else {
+      files->push_back({child_path, &child});
+    }
+  }
+}
+
+// Same as CollectTreeEntries for the directory record |dir| of |header|.
+void CollectBinaryTreeEntries(const BinaryHeader& header,
+                              uint32_t dir,
+                              const fs::path& prefix,
+                              std::vector<ExtractEntry>* dirs,
+                              std::vector<ExtractEntry>* links,
+                              std::vector<ExtractEntry>* files) {
+  const BinaryHeader::Record& record = header.record(dir);
+  for (uint32_t i = record.first_child; i < record.first_child + record.child_count; ++i) {
+    fs::path child_path = prefix / fs::path(std::string(header.name(i)));
+    switch (header.record(i).type) {
+      case BinaryHeader::kLink:
+        links->push_back({child_path, nullptr, i});
+        break;
+      case BinaryHeader::kDirectory:
+        dirs->push_back({child_path, nullptr, i});
+        CollectBinaryTreeEntries(header, i, child_path, dirs, links, files);
+        break;
+      default:
+        files->push_back({child_path, nullptr, i});
+        break;
+    }
+  }
+}
+
+// Collects the payloads of all packed files under |dir|.
+void CollectPackedPayloads(const nlohmann::json& dir,
+                           uint32_t header_size,
+                           std::vector<VerifiedSet::Payload>* payloads) {
+  if (!dir.contains("files") || !dir["files"].is_object())
+    return;
+
+  for (const auto& [name, child] : dir["files"].items()) {
+    if (child.contains("files")) {
+      CollectPackedPayloads(child, header_size, payloads);
+    } else if (child.contains("offset") && child["offset"].is_string() &&
+               child.contains("size") && child["size"].is_number_unsigned() &&
+               !child.value("unpacked", false)) {
+      payloads->emplace_back(std::stoull(child["offset"].get<std::string>()) + header_size,
+                             child["size"].get<uint64_t>());
+    }
+  }
+}
+
+Archive::FileType GetNodeType(const nlohmann::json& node) {
+  if (node.contains("link"))
+    return Archive::FileType::kLink;
+  if (node.contains("files"))
+    return Archive::FileType::kDirectory;
+  return Archive::FileType::kFile;
+}
+
+uint64_t ElapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
 // Simple pickle-like binary data reader
 #define PICKLE_HEADER_SIZE 4
 class PickleReader {
@@ -174,6 +351,13 @@ public:
   PickleReader(const std::vector<uint8_t>& data)
     : data_(data.data()), size_(data.size()), pos_(PICKLE_HEADER_SIZE) {}
 
+  // The payload size from the pickle header.
+  uint32_t payload_size() const {
+    uint32_t value = 0;
+    if (size_ >= PICKLE_HEADER_SIZE) std::memcpy(&value, data_, sizeof(value));
+    return value;
+  }
+
   bool ReadUInt32(uint32_t* value) {
     // memcpy
     if (pos_ + sizeof(uint32_t) > size_) return false;
@@ -199,6 +383,7 @@ public:
 IntegrityPayload::IntegrityPayload() = default;
 IntegrityPayload::~IntegrityPayload() = default;
 IntegrityPayload::IntegrityPayload(const IntegrityPayload& other) = default;
+IntegrityPayload& IntegrityPayload::operator=(const IntegrityPayload& other) = default;
 
 Archive::FileInfo::FileInfo() = default;
 Archive::FileInfo::~FileInfo() = default;
@@ -243,31 +428,308 @@ bool Archive::Init() {
     return false;
   }
 
-  // Read header content
-  std::vector<uint8_t> header_buf(header_size);
-  size = file_.read(reinterpret_cast<char*>(header_buf.data()), header_size);
-  if (size < header_size) {
-    LOG_ERROR("Failed to read header from " + path_.string());
-    return false;
+  // Binary headers are flagged by the payload size of the size pickle.
+  if (size_reader.payload_size() == BinaryHeader::kPickleMarker) {
+    if (!InitBinaryHeader(header_size)) {
+      LOG_ERROR("Failed to read binary header from " + path_.string());
+      return false;
+    }
+  } else {
+    // Read header content
+    std::vector<uint8_t> header_buf(header_size);
+    size = file_.read(reinterpret_cast<char*>(header_buf.data()), header_size);
+    if (size < header_size) {
+      LOG_ERROR("Failed to read header from " + path_.string());
+      return false;
+    }
+    PickleReader header_reader(header_buf);
+    std::string header_str;
+    if (!header_reader.ReadString(&header_str)) {
+      LOG_ERROR("Failed to parse header size from " + path_.string());
+      return false;
+    }
+    // Parse JSON header
+    header_ = nlohmann::json::parse(header_str, nullptr, false);
+    if (header_.is_discarded())
+    {
+        LOG_ERROR("parse error: " + path_.string());
+        return false;
+    }
   }
-  PickleReader header_reader(header_buf);
-  std::string header_str;
-  if (!header_reader.ReadString(&header_str)) {
-    LOG_ERROR("Failed to parse header size from " + path_.string());
+
+  header_size_ = ARCHIVE_HEADER_SIZE + header_size;
+  ReadIdentity(&opened_identity_);
+  BuildIndex();
+  // There is no embedded header hash to validate the header against outside
+  // Electron, so the header is trusted when integrity validation is enabled.
+  header_validated_ = IsIntegrityValidationEnabled();
+
+  if (header_validated_) {
+    ReadIdentity(&identity_);
+    std::vector<VerifiedSet::Payload> payloads;
+    if (binary_.valid()) {
+      for (uint32_t i = 0; i < binary_.entry_count(); ++i) {
+        const BinaryHeader::Record& record = binary_.record(i);
+        if (record.type == BinaryHeader::kFile && !(record.flags & BinaryHeader::kUnpacked))
+          payloads.emplace_back(record.offset + header_size_, record.size);
+      }
+    } else {
+      CollectPackedPayloads(header_, header_size_, &payloads);
+    }
+    verified_.Reset(std::move(payloads));
+  }
+  return true;
+}
+
+bool Archive::InitBinaryHeader(uint32_t size) {
+  auto mapping = std::make_unique<MappedFile>();
+  if (!mapping->MapRange(fd_, ARCHIVE_HEADER_SIZE, size, false) ||
+      !binary_.Init(mapping->data(), mapping->size()))
     return false;
+  binary_mapping_ = std::move(mapping);
+  return true;
+}
+
+void Archive::BuildIndex() {
+  index_.clear();
+  directory_index_.clear();
+  // The records of a binary header already are an index, see GetIndexEntry.
+  if (binary_.valid())
+    return;
+  index_.push_back({std::string_view(), FileType::kDirectory, 0U, 0U, &header_});
+
+  // Appending the children of each directory in turn keeps them contiguous.
+  for (size_t i = 0; i < index_.size(); ++i) {
+    if (index_[i].type != FileType::kDirectory)
+      continue;
+    const nlohmann::json& node = *index_[i].node;
+    directory_index_.emplace(&node, static_cast<uint32_t>(i));
+    if (!node.contains("files") || !node["files"].is_object())
+      continue;
+
+    const nlohmann::json& files = node["files"];
+    index_[i].first_child = static_cast<uint32_t>(index_.size());
+    index_[i].child_count = static_cast<uint32_t>(files.size());
+    for (const auto& [name, child] : files.items()) {
+      index_.push_back({std::string_view(name), GetNodeType(child), 0U, 0U, &child});
+    }
   }
-  // Parse JSON header
-  header_ = nlohmann::json::parse(header_str, nullptr, false);
-  if (header_.is_discarded())
-  {
-      LOG_ERROR("parse error: " + path_.string());
+}
+
+Archive::IndexEntry Archive::GetIndexEntry(uint32_t index) const {
+  if (!binary_.valid())
+    return index_[index];
+  const BinaryHeader::Record& record = binary_.record(index);
+  const bool is_directory = record.type == BinaryHeader::kDirectory;
+  return {binary_.name(index), static_cast<FileType>(record.type),
+          is_directory ? record.first_child : 0U, is_directory ? record.child_count : 0U,
+          nullptr};
+}
+
+bool Archive::FindDirectory(const fs::path& path, uint32_t* index) const {
+  if (binary_.valid()) {
+    uint32_t found = FindBinaryEntry(path.string());
+    if (found != BinaryHeader::kNotFound && GetIndexEntry(found).type == FileType::kLink)
+      found = FindBinaryEntry(binary_.link(found));
+    if (found == BinaryHeader::kNotFound || GetIndexEntry(found).type != FileType::kDirectory)
       return false;
+    *index = found;
+    return true;
   }
+  if (header_.is_null())
+    return false;
 
-  header_size_ = ARCHIVE_HEADER_SIZE + header_size;
+  const nlohmann::json* node = GetNodeFromPath(path.string(), header_);
+  if (node && node->contains("link") && (*node)["link"].is_string())
+    node = GetNodeFromPath((*node)["link"].get<std::string>(), header_);
+  if (!node)
+    return false;
+
+  auto it = directory_index_.find(node);
+  if (it == directory_index_.end())
+    return false;
+  *index = it->second;
+  return true;
+}
+
+bool Archive::Identity::operator==(const Identity& other) const {
+  return dev == other.dev && ino == other.ino && size == other.size &&
+         mtime_ns == other.mtime_ns;
+}
+
+bool Archive::ReadIdentity(Identity* identity, bool from_path) const {
+#if defined(_WIN32)
+  struct _stat64 st;
+  if ((from_path ? _wstat64(path_.c_str(), &st) : _fstat64(fd_, &st)) != 0)
+    return false;
+  identity->mtime_ns = static_cast<int64_t>(st.st_mtime) * 1000000000;
+#else
+  struct stat st;
+  if ((from_path ? stat(path_.c_str(), &st) : fstat(fd_, &st)) != 0)
+    return false;
+#if defined(__APPLE__)
+  identity->mtime_ns = static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+  identity->mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+#endif
+  identity->dev = st.st_dev;
+  identity->ino = st.st_ino;
+  identity->size = st.st_size;
+  return true;
+}
+
+bool Archive::IsStale() const {
+  for (const auto& layer : layers_) {
+    if (layer->IsStale())
+      return true;
+  }
+  // The opened file rewritten in place, e.g. its header converted: a mapped
+  // binary header may no longer be the one checked by Init.
+  Identity identity;
+  if (ReadIdentity(&identity) && !(identity == opened_identity_))
+    return true;
+  // A missing file is in the middle of being replaced, or gone for good;
+  // either way there is nothing newer to load yet.
+  if (!ReadIdentity(&identity, true))
+    return false;
+  return !(identity == opened_identity_);
+}
+
+bool Archive::IsVerified(const FileInfo& info) const {
+  const Archive& owner = Owner(info);
+  if (&owner != this)
+    return owner.IsVerified(info);
+  if (!verified_.Contains(info.offset, info.size))
+    return false;
+
+  // The archive is held open, so only in place modifications can change the
+  // content behind |fd_|.
+  Identity identity;
+  if (!ReadIdentity(&identity))
+    return false;
+  std::lock_guard<std::mutex> lock(identity_lock_);
+  if (identity == identity_)
+    return true;
+
+  LOG_WARNING("Archive modified, integrity has to be validated again: " + path_.string());
+  identity_ = identity;
+  verified_.Clear();
+  return false;
+}
+
+void Archive::MarkVerified(const FileInfo& info, uint64_t hash_ns) const {
+  const Archive& owner = Owner(info);
+  if (&owner != this)
+    return owner.MarkVerified(info, hash_ns);
+  verified_.Add(info.offset, info.size, hash_ns);
+}
+
+bool Archive::ValidateFileContent(const FileInfo& info,
+                                  std::string_view content,
+                                  unsigned concurrency) const {
+  if (!info.integrity || IsVerified(info))
+    return true;
+  return ValidateAndMarkVerified(info, content,
+                                 concurrency == 0 ? HashConcurrency(content.size()) : concurrency);
+}
+
+bool Archive::ValidateAndMarkVerified(const FileInfo& info,
+                                      std::string_view content,
+                                      unsigned concurrency) const {
+  const auto start = std::chrono::steady_clock::now();
+  if (!ValidateFileIntegrity(content, *info.integrity, concurrency))
+    return false;
+  MarkVerified(info, ElapsedNs(start));
   return true;
 }
 
+bool Archive::VerifyAll(unsigned concurrency, const VerifyCallback& callback) const {
+  if (!has_header())
+    return false;
+
+  struct PackedFile {
+    fs::path path;
+    FileInfo info;
+  };
+
+  std::vector<ExtractEntry> dirs, links, entries;
+  if (binary_.valid())
+    CollectBinaryTreeEntries(binary_, 0, fs::path(), &dirs, &links, &entries);
+  else
+    CollectTreeEntries(header_, header_, fs::path(), &dirs, &links, &entries);
+
+  std::vector<PackedFile> files;
+  files.reserve(entries.size());
+  for (const auto& entry : entries) {
+    PackedFile file{entry.path, FileInfo()};
+    const bool filled = entry.node ? FillFileInfo(entry.node, &file.info)
+                                   : FillFileInfo(entry.index, &file.info);
+    if (filled &&
+        !file.info.unpacked && file.info.integrity)
+      files.push_back(std::move(file));
+  }
+
+  // Read the archive front to back, files sharing a payload are hashed once.
+  // Empty files share their offset with the next file without sharing its
+  // payload, so the size is part of the key.
+  std::sort(files.begin(), files.end(), [](const PackedFile& a, const PackedFile& b) {
+    return std::tie(a.info.layer, a.info.offset, a.info.size) <
+           std::tie(b.info.layer, b.info.offset, b.info.size);
+  });
+  files.erase(std::unique(files.begin(), files.end(), [](const PackedFile& a, const PackedFile& b) {
+    return a.info.layer == b.info.layer && a.info.offset == b.info.offset &&
+           a.info.size == b.info.size;
+  }), files.end());
+
+  VerifyEvent progress;
+  progress.total_files = files.size();
+  for (const auto& file : files)
+    progress.total_bytes += file.info.size;
+
+  std::mutex progress_lock;
+  const uint64_t report_interval = std::max<uint64_t>(1, files.size() / 100);
+  auto report = [&](const PackedFile& file, bool ok) {
+    std::lock_guard<std::mutex> lock(progress_lock);
+    if (ok) {
+      progress.verified_files++;
+      progress.verified_bytes += file.info.size;
+    } else {
+      progress.failed_files++;
+    }
+    const uint64_t done = progress.verified_files + progress.failed_files;
+    if (!callback || (ok && done % report_interval != 0 && done != progress.total_files))
+      return;
+    VerifyEvent event = progress;
+    if (!ok)
+      event.failed_path = file.path.string();
+    callback(event);
+  };
+
+  ParallelFor(files.size(), concurrency, [&](size_t index) {
+    const PackedFile& file = files[index];
+    if (IsVerified(file.info)) {
+      report(file, true);
+      return true;
+    }
+
+    // Files are already hashed in parallel, hash the blocks inline so that
+    // no more than |concurrency| threads hash.
+    std::string buf(file.info.size, '\0');
+    const bool ok = ReadFromFD(Owner(file.info).fd_, file.info.offset, buf.data(), buf.size()) &&
+                    ValidateAndMarkVerified(file.info, buf, 1);
+    report(file, ok);
+    // Keep going, all failures are reported.
+    return true;
+  });
+
+  return progress.failed_files == 0;
+}
+
+VerifiedSet::Counters Archive::IntegrityCounters() const {
+  return verified_.GetCounters();
+}
+
 std::optional<IntegrityPayload> Archive::HeaderIntegrity() const {
   return std::nullopt; // Placeholder - would need crypto implementation
 }
@@ -277,6 +739,14 @@ std::optional<std::filesystem::path> Archive::RelativePath() const {
 }
 
 bool Archive::GetFileInfo(const std::filesystem::path& path, FileInfo* info) const {
+  if (binary_.valid()) {
+    const uint32_t index = FindBinaryEntry(path.string());
+    if (index == BinaryHeader::kNotFound)
+      return false;
+    if (GetIndexEntry(index).type == FileType::kLink)
+      return GetFileInfo(std::filesystem::path(std::string(binary_.link(index))), info);
+    return FillFileInfo(index, info);
+  }
   if (header_.is_null())
     return false;
 
@@ -289,10 +759,17 @@ bool Archive::GetFileInfo(const std::filesystem::path& path, FileInfo* info) con
     return GetFileInfo(std::filesystem::path(link), info);
   }
 
-  return FillFileInfoWithNode(info, header_size_, header_validated_, node);
+  return FillFileInfo(node, info);
 }
 
 bool Archive::Stat(const std::filesystem::path& path, Stats* stats) const {
+  if (binary_.valid()) {
+    const uint32_t index = FindBinaryEntry(path.string());
+    if (index == BinaryHeader::kNotFound)
+      return false;
+    stats->type = GetIndexEntry(index).type;
+    return stats->type != FileType::kFile || FillFileInfo(index, stats);
+  }
   if (header_.is_null())
     return false;
 
@@ -310,11 +787,20 @@ bool Archive::Stat(const std::filesystem::path& path, Stats* stats) const {
     return true;
   }
 
-  return FillFileInfoWithNode(stats, header_size_, header_validated_, node);
+  return FillFileInfo(node, stats);
 }
 
 bool Archive::Readdir(const std::filesystem::path& path,
                       std::vector<std::filesystem::path>* files) const {
+  if (binary_.valid()) {
+    uint32_t index;
+    if (!FindDirectory(path, &index))
+      return false;
+    const IndexEntry dir = GetIndexEntry(index);
+    for (uint32_t i = dir.first_child; i < dir.first_child + dir.child_count; ++i)
+      files->push_back(std::filesystem::path(binary_.name(i)));
+    return true;
+  }
   if (header_.is_null())
     return false;
 
@@ -332,8 +818,63 @@ bool Archive::Readdir(const std::filesystem::path& path,
   return true;
 }
 
+bool Archive::ReaddirWithTypes(const fs::path& path,
+                               std::vector<DirectoryEntry>* entries) const {
+  uint32_t index;
+  if (!FindDirectory(path, &index))
+    return false;
+
+  const IndexEntry dir = GetIndexEntry(index);
+  entries->reserve(entries->size() + dir.child_count);
+  for (uint32_t i = dir.first_child; i < dir.first_child + dir.child_count; ++i) {
+    const IndexEntry child = GetIndexEntry(i);
+    entries->push_back({child.name, child.type});
+  }
+  return true;
+}
+
+bool Archive::Walk(const fs::path& path,
+                   uint32_t max_depth,
+                   std::vector<WalkEntry>* entries) const {
+  uint32_t index;
+  if (!FindDirectory(path, &index))
+    return false;
+
+  std::string prefix;
+  WalkDirectory(index, &prefix, 1, max_depth, entries);
+  return true;
+}
+
+void Archive::WalkDirectory(uint32_t index,
+                            std::string* prefix,
+                            uint32_t depth,
+                            uint32_t max_depth,
+                            std::vector<WalkEntry>* entries) const {
+  const IndexEntry dir = GetIndexEntry(index);
+  const size_t prefix_length = prefix->size();
+  for (uint32_t i = dir.first_child; i < dir.first_child + dir.child_count; ++i) {
+    const IndexEntry child = GetIndexEntry(i);
+    prefix->append(child.name);
+    entries->push_back({*prefix, child.type});
+    if (child.type == FileType::kDirectory && (max_depth == 0 || depth < max_depth)) {
+      prefix->push_back(kSeparators[0]);
+      WalkDirectory(i, prefix, depth + 1, max_depth, entries);
+    }
+    prefix->resize(prefix_length);
+  }
+}
+
 bool Archive::Realpath(const std::filesystem::path& path,
                        std::filesystem::path* realpath) const {
+  if (binary_.valid()) {
+    const uint32_t index = FindBinaryEntry(path.string());
+    if (index == BinaryHeader::kNotFound)
+      return false;
+    *realpath = GetIndexEntry(index).type == FileType::kLink
+                    ? std::filesystem::path(std::string(binary_.link(index)))
+                    : path;
+    return true;
+  }
   if (header_.is_null())
     return false;
 
@@ -351,15 +892,126 @@ bool Archive::Realpath(const std::filesystem::path& path,
   return true;
 }
 
+std::unique_ptr<MappedFile> Archive::MapFile(const FileInfo& info) const {
+  if (info.unpacked || info.size == 0)
+    return nullptr;
+  const Archive& owner = Owner(info);
+  if (&owner != this)
+    return owner.MapFile(info);
+
+  // Pages past the end of a truncated archive would fault when touched.
+  Identity identity;
+  if (!ReadIdentity(&identity) || info.offset + info.size > identity.size)
+    return nullptr;
+
+  auto mapped = std::make_unique<MappedFile>();
+  if (!mapped->MapRange(fd_, info.offset, info.size, true))
+    return nullptr;
+  return mapped;
+}
+
+Archive::ReadResult Archive::ReadFile(const FileInfo& info, char* out) const {
+  if (info.unpacked)
+    return ReadResult::kFailed;
+  const Archive& owner = Owner(info);
+  if (&owner != this)
+    return owner.ReadFile(info, out);
+
+  // Small files, most module sources, are hashed inline after the read,
+  // overlapping is not worth starting threads.
+  const bool validate = info.integrity && !IsVerified(info);
+  if (!validate || HashConcurrency(info.size) == 1U ||
+      !HasIntegrityBlocks(*info.integrity, info.size)) {
+    if (!ReadFromFD(fd_, info.offset, out, info.size))
+      return ReadResult::kFailed;
+    if (validate && !ValidateAndMarkVerified(info, std::string_view(out, info.size), 1))
+      return ReadResult::kIntegrityFailed;
+    return ReadResult::kSuccess;
+  }
+
+  // Hash the blocks already read while reading the next ones.
+  const uint32_t block_size = info.integrity->block_size;
+  BlockVerifier verifier(*info.integrity, out, info.size, 0);
+  for (uint64_t position = 0; position < info.size; position += block_size) {
+    const size_t chunk = static_cast<size_t>(std::min<uint64_t>(block_size, info.size - position));
+    if (!ReadFromFD(fd_, info.offset + position, out + position, chunk)) {
+      verifier.Finish();
+      return ReadResult::kFailed;
+    }
+    verifier.Feed(position + chunk);
+  }
+  if (!verifier.Finish())
+    return ReadResult::kIntegrityFailed;
+
+  MarkVerified(info, verifier.hash_ns());
+  return ReadResult::kSuccess;
+}
+
+Archive::ReadResult Archive::ReadFileRange(const FileInfo& info,
+                                           uint64_t position,
+                                           size_t* length,
+                                           char* out) const {
+  if (info.unpacked || position > info.size)
+    return ReadResult::kFailed;
+  const Archive& owner = Owner(info);
+  if (&owner != this)
+    return owner.ReadFileRange(info, position, length, out);
+
+  *length = static_cast<size_t>(std::min<uint64_t>(*length, info.size - position));
+  if (*length == 0)
+    return ReadResult::kSuccess;
+
+  if (!info.integrity || IsVerified(info)) {
+    return ReadFromFD(fd_, info.offset + position, out, *length)
+        ? ReadResult::kSuccess : ReadResult::kFailed;
+  }
+
+  // Only the blocks covering the range have to be read and validated, without
+  // block hashes the whole file has to.
+  uint64_t begin = 0;
+  uint64_t end = info.size;
+  size_t first_block = 0;
+  const bool has_blocks = HasIntegrityBlocks(*info.integrity, info.size);
+  if (has_blocks) {
+    const uint32_t block_size = info.integrity->block_size;
+    first_block = static_cast<size_t>(position / block_size);
+    begin = first_block * block_size;
+    end = std::min<uint64_t>(((position + *length - 1) / block_size + 1) * block_size, info.size);
+  }
+
+  std::string buf(end - begin, '\0');
+  if (!ReadFromFD(fd_, info.offset + begin, buf.data(), buf.size()))
+    return ReadResult::kFailed;
+
+  if (begin == 0 && end == info.size) {
+    if (!ValidateAndMarkVerified(info, buf, HashConcurrency(buf.size())))
+      return ReadResult::kIntegrityFailed;
+  } else if (!ValidateIntegrityBlocks(buf, *info.integrity, first_block, HashConcurrency(buf.size()))) {
+    return ReadResult::kIntegrityFailed;
+  }
+
+  std::memcpy(out, buf.data() + (position - begin), *length);
+  return ReadResult::kSuccess;
+}
+
 bool Archive::CopyFileOut(const std::filesystem::path& path, std::filesystem::path* out) {
-  if (header_.is_null())
+  return AcquireFileOut(path, out, nullptr);
+}
+
+bool Archive::AcquireFileOut(const std::filesystem::path& path,
+                             std::filesystem::path* out,
+                             std::shared_ptr<ScopedTemporaryFile>* handle) {
+  if (!has_header())
     return false;
 
   std::lock_guard<std::mutex> lock(external_files_lock_);
 
   auto it = external_files_.find(path.string());
   if (it != external_files_.end()) {
-    *out = it->second->path();
+    external_files_lru_.splice(external_files_lru_.begin(), external_files_lru_, it->second.lru);
+    *out = it->second.file->path();
+    if (handle)
+      *handle = it->second.file;
     return true;
   }
 
@@ -367,17 +1019,23 @@ bool Archive::CopyFileOut(const std::filesystem::path& path, std::filesystem::pa
   if (!GetFileInfo(path, &info))
     return false;
 
+  const Archive& owner = Owner(info);
   if (info.unpacked) {
-    *out = path_;
+    *out = owner.path_;
     *out += ".unpacked";
     *out /= path;
     return true;
   }
 
-  auto temp_file = std::make_unique<ScopedTemporaryFile>();
+  auto temp_file = std::make_shared<ScopedTemporaryFile>();
   std::string ext = path.extension().string();
-  if (!temp_file->InitFromFile(fd_, ext, info.offset, info.size, info.integrity))
+  const bool validate = info.integrity && !IsVerified(info);
+  const auto start = std::chrono::steady_clock::now();
+  if (!temp_file->InitFromFile(owner.fd_, ext, info.offset, info.size,
+                               validate ? info.integrity : std::nullopt))
     return false;
+  if (validate)
+    MarkVerified(info, ElapsedNs(start));
 
 #if !defined(_WIN32)
   if (info.executable) {
@@ -387,12 +1045,308 @@ bool Archive::CopyFileOut(const std::filesystem::path& path, std::filesystem::pa
 #endif
 
   *out = temp_file->path();
-  external_files_[path.string()] = std::move(temp_file);
+  if (handle)
+    *handle = temp_file;
+
+  external_files_lru_.push_front(path.string());
+  external_files_[path.string()] = {temp_file, info.size, external_files_lru_.begin()};
+  external_files_bytes_ += info.size;
+  // |temp_file| is still referenced here so the new file is never evicted.
+  EvictExternalFilesLocked();
   return true;
 }
 
+Archive::MemoryUsage Archive::GetMemoryUsage() const {
+  MemoryUsage usage;
+  usage.header_bytes = EstimateJsonBytes(header_);
+  usage.index_bytes = index_.capacity() * sizeof(IndexEntry) +
+                      directory_index_.size() * (sizeof(void*) + sizeof(std::pair<const nlohmann::json*, uint32_t>)) +
+                      directory_index_.bucket_count() * sizeof(void*);
+  usage.mapped_bytes = binary_mapping_ ? binary_mapping_->size() : 0U;
+
+  std::lock_guard<std::mutex> lock(external_files_lock_);
+  usage.extracted_files = external_files_.size();
+  usage.extracted_bytes = external_files_bytes_;
+  return usage;
+}
+
+void Archive::SetFileOutLimits(uint64_t max_bytes, size_t max_entries) {
+  std::lock_guard<std::mutex> lock(external_files_lock_);
+  max_external_files_bytes_ = max_bytes;
+  max_external_files_ = max_entries;
+  EvictExternalFilesLocked();
+}
+
+void Archive::EvictExternalFilesLocked() {
+  auto over_limits = [this]() {
+    return (max_external_files_bytes_ && external_files_bytes_ > max_external_files_bytes_) ||
+           (max_external_files_ && external_files_.size() > max_external_files_);
+  };
+
+  auto lru = external_files_lru_.end();
+  while (over_limits() && lru != external_files_lru_.begin()) {
+    --lru;
+    auto it = external_files_.find(*lru);
+    // Files still held by a handle are in use, skip them.
+    if (it->second.file.use_count() > 1)
+      continue;
+
+    external_files_bytes_ -= it->second.size;
+    external_files_.erase(it);
+    lru = external_files_lru_.erase(lru);
+  }
+}
+
+bool Archive::ExtractTree(const fs::path& path,
+                          const fs::path& dest,
+                          unsigned concurrency,
+                          ExtractStats* stats) const {
+  const auto start = std::chrono::steady_clock::now();
+  if (!has_header())
+    return false;
+
+  std::vector<ExtractEntry> dirs, links, files;
+  if (binary_.valid()) {
+    uint32_t index;
+    if (!FindDirectory(path, &index)) {
+      stats->error = "Not a directory in archive: " + path.string();
+      return false;
+    }
+    CollectBinaryTreeEntries(binary_, index, fs::path(), &dirs, &links, &files);
+  } else {
+    const nlohmann::json* node = GetNodeFromPath(path.string(), header_);
+    if (!node || !GetFilesNode(header_, *node)) {
+      stats->error = "Not a directory in archive: " + path.string();
+      return false;
+    }
+    CollectTreeEntries(header_, *node, fs::path(), &dirs, &links, &files);
+  }
+
+  // Entry names come from the header, none may lead out of |dest|.
+  for (const auto* entries : {&dirs, &links, &files}) {
+    for (const auto& entry : *entries) {
+      if (entry.path.lexically_normal() != entry.path || entry.path == "." ||
+          !IsWithin(entry.path, fs::path())) {
+        stats->error = "Unsafe path in archive: " + entry.path.string();
+        return false;
+      }
+    }
+  }
+
+  // Create the directory skeleton first so the workers only write files.
+  std::error_code ec;
+  fs::create_directories(dest, ec);
+  if (ec) {
+    stats->error = "Failed to create directory " + dest.string() + ": " + ec.message();
+    return false;
+  }
+  for (const auto& dir : dirs) {
+    fs::create_directories(dest / dir.path, ec);
+    if (ec) {
+      stats->error = "Failed to create directory " + (dest / dir.path).string() + ": " + ec.message();
+      return false;
+    }
+  }
+  stats->directories = dirs.size();
+
+  // Links in the header are relative to the archive root, make them relative
+  // to the link itself so that they keep working in |dest|.
+  // Targets outside the extracted directory would point out of |dest|.
+  const fs::path root = path.relative_path();
+  for (const auto& link : links) {
+    const fs::path archive_path = root / link.path;
+    const fs::path archive_target(link.node ? (*link.node)["link"].get<std::string>()
+                                            : std::string(binary_.link(link.index)));
+    const fs::path target = archive_target.lexically_relative(archive_path.parent_path());
+    const fs::path link_path = dest / link.path;
+    if (!IsWithin(archive_target, root) || target.empty() ||
+        !IsWithin(link_path.parent_path() / target, dest)) {
+      stats->error = "Unsafe link in archive: " + link.path.string() + " -> " + archive_target.string();
+      return false;
+    }
+    fs::remove(link_path, ec);
+    fs::create_symlink(target, link_path, ec);
+    if (ec) {
+      stats->error = "Failed to create link " + link_path.string() + ": " + ec.message();
+      return false;
+    }
+  }
+  stats->links = links.size();
+
+  std::mutex error_lock;
+  std::atomic<uint64_t> bytes{0};
+  auto fail = [&](const std::string& error) {
+    std::lock_guard<std::mutex> lock(error_lock);
+    if (stats->error.empty())
+      stats->error = error;
+    return false;
+  };
+
+  bool ok = ParallelFor(files.size(), concurrency, [&](size_t index) {
+    const ExtractEntry& entry = files[index];
+    const fs::path out_path = dest / entry.path;
+
+    FileInfo info;
+    if (!(entry.node ? FillFileInfo(entry.node, &info) : FillFileInfo(entry.index, &info)))
+      return fail("Invalid file info: " + entry.path.string());
+    const Archive& owner = Owner(info);
+
+    std::error_code copy_ec;
+    if (info.unpacked) {
+      fs::copy_file(fs::path(owner.path_.string() + ".unpacked") / path / entry.path, out_path,
+                    fs::copy_options::overwrite_existing, copy_ec);
+      if (copy_ec)
+        return fail("Failed to copy unpacked file " + out_path.string() + ": " + copy_ec.message());
+      bytes += info.size;
+      return true;
+    }
+
+    std::string buf(info.size, '\0');
+    if (!ReadFromFD(owner.fd_, info.offset, buf.data(), info.size))
+      return fail("Failed to read " + entry.path.string() + " from " + owner.path_.string());
+
+    // Files are already extracted in parallel, hash the blocks inline.
+    if (!ValidateFileContent(info, buf, 1))
+      return fail("Integrity check failed for " + entry.path.string());
+
+    std::ofstream out(out_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+      return fail("Failed to open " + out_path.string());
+    out.write(buf.data(), buf.size());
+    out.close();
+    if (out.fail())
+      return fail("Failed to write " + out_path.string());
+
+#if !defined(_WIN32)
+    chmod(out_path.c_str(), info.executable ? 0755 : 0644);
+#endif
+
+    bytes += info.size;
+    return true;
+  });
+
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  stats->files = files.size();
+  stats->bytes = bytes;
+  stats->elapsed_ms = elapsed.count();
+  stats->bytes_per_second =
+      elapsed.count() > 0 ? stats->bytes * 1000.0 / elapsed.count() : 0;
+  return ok;
+}
+
 int Archive::GetUnsafeFD() const {
   return fd_;
 }
 
+int Archive::GetUnsafeFD(const FileInfo& info) const {
+  return Owner(info).fd_;
+}
+
+const Archive& Archive::Owner(const FileInfo& info) const {
+  // Layers have no layers of their own, files of one belong to it.
+  if (info.layer == 0 || info.layer > layers_.size())
+    return *this;
+  return *layers_[info.layer - 1];
+}
+
+bool Archive::FillFileInfo(const nlohmann::json* node, FileInfo* info) const {
+  info->layer = 0;
+  auto it = node->find(kLayerKey);
+  if (it != node->end() && it->is_number_unsigned())
+    info->layer = it->get<uint32_t>();
+  if (info->layer > layers_.size())
+    return false;
+  const Archive& owner = Owner(*info);
+  return FillFileInfoWithNode(info, owner.header_size_, owner.header_validated_, node);
+}
+
+bool Archive::FillFileInfo(uint32_t index, FileInfo* info) const {
+  const BinaryHeader::Record& record = binary_.record(index);
+  if (record.type != BinaryHeader::kFile)
+    return false;
+
+  info->layer = 0;
+  info->size = static_cast<uint32_t>(record.size);
+  info->unpacked = record.flags & BinaryHeader::kUnpacked;
+  if (info->unpacked)
+    return true;
+  info->offset = record.offset + header_size_;
+  info->executable = record.flags & BinaryHeader::kExecutable;
+
+  if (header_validated_) {
+    if (!(record.flags & BinaryHeader::kIntegrity)) {
+      LOG_ERROR("Failed to read integrity for file in ASAR archive");
+      return false;
+    }
+    IntegrityPayload integrity;
+    integrity.algorithm = HashAlgorithm::kSHA256;
+    integrity.hash = binary_.DigestHex(record.digest);
+    integrity.block_size = record.block_size;
+    integrity.blocks.reserve(record.block_count);
+    for (uint32_t block = 0; block < record.block_count; ++block)
+      integrity.blocks.push_back(binary_.DigestHex(record.digest + 1 + block));
+    info->integrity = std::move(integrity);
+  }
+  return true;
+}
+
+uint32_t Archive::FindBinaryEntry(std::string_view path, uint32_t depth) const {
+  if (path.empty())
+    return 0;
+  // Most lookups are of paths with no links along the way, which are in
+  // the path table as they are when "/" separated.
+#if defined(_WIN32)
+  if (path.find('\\') == std::string_view::npos) {
+#else
+  {
+#endif
+    const uint32_t index = binary_.FindPath(path);
+    if (index != BinaryHeader::kNotFound)
+      return index;
+  }
+
+  uint32_t dir = 0;
+  size_t begin = 0;
+  while (true) {
+    const size_t end = path.find_first_of(kSeparators, begin);
+    const std::string_view name = path.substr(begin, end == std::string_view::npos ? end : end - begin);
+    uint32_t child = 0;
+    if (!name.empty()) {
+      // Links along the path resolve to the directory they point at.
+      if (GetIndexEntry(dir).type == FileType::kLink) {
+        if (depth >= kMaxLinkDepth)
+          return BinaryHeader::kNotFound;
+        dir = FindBinaryEntry(binary_.link(dir), depth + 1);
+        if (dir == BinaryHeader::kNotFound)
+          return BinaryHeader::kNotFound;
+      }
+      child = binary_.FindChild(dir, name);
+      if (child == BinaryHeader::kNotFound)
+        return BinaryHeader::kNotFound;
+    }
+    if (end == std::string_view::npos)
+      return child;
+    dir = child;
+    begin = end + 1;
+  }
+}
+
+void Archive::SetLayers(std::vector<std::shared_ptr<Archive>> layers) {
+  assert(layers_.empty());
+  layers_ = std::move(layers);
+  // Merging works on JSON trees, binary headers are converted once.
+  if (binary_.valid()) {
+    header_ = binary_.ToJson();
+    binary_.Reset();
+    binary_mapping_.reset();
+  }
+  for (size_t i = 0; i < layers_.size(); ++i) {
+    const Archive& layer = *layers_[i];
+    MergeDirectory(&header_, layer.binary_.valid() ? layer.binary_.ToJson() : layer.header_,
+                   static_cast<uint32_t>(i + 1));
+  }
+  BuildIndex();
+}
+
 }  // namespace asar
\ No newline at end of file
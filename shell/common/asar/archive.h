@@ -5,16 +5,24 @@
 #ifndef ELECTRON_SHELL_COMMON_ASAR_ARCHIVE_H_
 #define ELECTRON_SHELL_COMMON_ASAR_ARCHIVE_H_
 
+#include <atomic>
+#include <functional>
+#include <list>
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 #include <uv.h>
 #include <filesystem>
 #include <fstream>
 #include <mutex>
 #include <nlohmann/json.hpp>
+#include "./binary_header.h"
 #include "./file.h"
+#include "./integrity.h"
+#include "./mapped_file.h"
 
 namespace fs = std::filesystem;
 
@@ -31,6 +39,7 @@ struct IntegrityPayload {
   IntegrityPayload();
   ~IntegrityPayload();
   IntegrityPayload(const IntegrityPayload& other);
+  IntegrityPayload& operator=(const IntegrityPayload& other);
   HashAlgorithm algorithm = HashAlgorithm::kNone;
   std::string hash;
   uint32_t block_size = 0U;
@@ -49,6 +58,8 @@ class Archive {
     uint32_t size = 0U;
     uint64_t offset = 0U;
     std::optional<IntegrityPayload> integrity;
+    // Layer of an overlay archive the file is in, 0 for the archive itself.
+    uint32_t layer = 0U;
   };
 
   enum class FileType {
@@ -61,6 +72,56 @@ class Archive {
     FileType type = FileType::kFile;
   };
 
+  struct WalkEntry {
+    // Relative to the walked directory.
+    std::string path;
+    FileType type = FileType::kFile;
+  };
+
+  struct DirectoryEntry {
+    // Points into the header, valid as long as the archive.
+    std::string_view name;
+    FileType type = FileType::kFile;
+  };
+
+  enum class ReadResult {
+    kSuccess,
+    kFailed,
+    kIntegrityFailed,
+  };
+
+  struct VerifyEvent {
+    uint64_t verified_files = 0U;
+    uint64_t failed_files = 0U;
+    uint64_t total_files = 0U;
+    uint64_t verified_bytes = 0U;
+    uint64_t total_bytes = 0U;
+    // Set when the event reports a file failing validation.
+    std::string failed_path;
+  };
+
+  using VerifyCallback = std::function<void(const VerifyEvent&)>;
+
+  struct ExtractStats {
+    uint64_t files = 0U;
+    uint64_t links = 0U;
+    uint64_t directories = 0U;
+    uint64_t bytes = 0U;
+    double elapsed_ms = 0;
+    double bytes_per_second = 0;
+    std::string error;
+  };
+
+  // Approximate memory held by an archive.
+  struct MemoryUsage {
+    uint64_t header_bytes = 0U;
+    uint64_t index_bytes = 0U;
+    // Address space of the binary header mapping, paged in on demand.
+    uint64_t mapped_bytes = 0U;
+    uint64_t extracted_files = 0U;
+    uint64_t extracted_bytes = 0U;
+  };
+
   explicit Archive(const fs::path& path);
   virtual ~Archive();
 
@@ -84,22 +145,163 @@ class Archive {
   bool Readdir(const fs::path& path,
                std::vector<fs::path>* files) const;
 
+  // Fs.readdir(path, {withFileTypes: true}), served from the directory
+  // index built by Init.
+  bool ReaddirWithTypes(const fs::path& path,
+                        std::vector<DirectoryEntry>* entries) const;
+
+  // Lists all descendants of the directory |path| depth first, at most
+  // |max_depth| levels deep, 0 for no limit. Links are listed but not
+  // followed, like fs.readdir(path, {recursive: true}) does.
+  bool Walk(const fs::path& path,
+            uint32_t max_depth,
+            std::vector<WalkEntry>* entries) const;
+
   // Fs.realpath(path).
   bool Realpath(const fs::path& path, fs::path* realpath) const;
 
+  // Read the content of the packed file described by |info| into |out|,
+  // which must hold |info.size| bytes. Integrity blocks are validated on
+  // worker threads while the following blocks are still being read.
+  ReadResult ReadFile(const FileInfo& info, char* out) const;
+
+  // Read |length| bytes at |position| of the packed file described by |info|
+  // into |out|, only the integrity blocks touched by the range are read in
+  // full and validated. |length| is clamped to the end of file.
+  ReadResult ReadFileRange(const FileInfo& info,
+                           uint64_t position,
+                           size_t* length,
+                           char* out) const;
+
+  // Maps the packed file described by |info| on its own, independently of
+  // the archive's lifetime. The pages are copy-on-write so the mapping can
+  // be handed out writable. Files aligned by the packer start at a page
+  // boundary, others share their first and last page with their neighbours.
+  // Returns nullptr for unpacked or empty files, or when mapping fails. The
+  // content is not validated, see ValidateFileContent.
+  std::unique_ptr<MappedFile> MapFile(const FileInfo& info) const;
+
+  // Validate |content| read out of the packed file described by |info|,
+  // its blocks are hashed on up to |concurrency| threads, 0 to hash small
+  // files inline and larger ones on one thread per core, see
+  // HashConcurrency. Files validated before are not hashed again while the
+  // archive file keeps its identity.
+  bool ValidateFileContent(const FileInfo& info,
+                           std::string_view content,
+                           unsigned concurrency = 0) const;
+
+  // Validate every packed file that has integrity info on up to
+  // |concurrency| threads, in payload order. Files that pass are marked as
+  // verified so that reads skip hashing them. Progress and failures are
+  // reported to |callback| from the worker threads, one call at a time.
+  // Returns false if any file failed validation.
+  bool VerifyAll(unsigned concurrency, const VerifyCallback& callback) const;
+
+  // Counters of the verify-once cache.
+  VerifiedSet::Counters IntegrityCounters() const;
+
+  MemoryUsage GetMemoryUsage() const;
+
   // Copy the file into a temporary file, and return the new path.
   // For unpacked file, this method will return its real path.
   bool CopyFileOut(const fs::path& path, fs::path* out);
 
+  // Same with CopyFileOut, but also hands out a reference to the temporary
+  // file, it will not be evicted while |handle| is alive. |handle| is left
+  // empty for unpacked files.
+  bool AcquireFileOut(const fs::path& path,
+                      fs::path* out,
+                      std::shared_ptr<ScopedTemporaryFile>* handle);
+
+  // Limits the total size and count of temporary files created by
+  // CopyFileOut, least recently used files without live handles are removed
+  // when a limit is exceeded. 0 means unlimited.
+  void SetFileOutLimits(uint64_t max_bytes, size_t max_entries);
+
+  // Extract the directory |path| with all its descendants into |dest|,
+  // file contents are read and written on up to |concurrency| threads.
+  // Executable bits and links are preserved, files with integrity info are
+  // validated before being written.
+  bool ExtractTree(const fs::path& path,
+                   const fs::path& dest,
+                   unsigned concurrency,
+                   ExtractStats* stats) const;
+
   // Returns the file's fd.
   // Using this fd will not validate the integrity of any files
   // you read out of the ASAR manually.  Callers are responsible
   // for integrity validation after this fd is handed over.
   int GetUnsafeFD() const;
+  // The fd holding the data of |info|, which differs for files of layers.
+  int GetUnsafeFD(const FileInfo& info) const;
+
+  // Stacks |layers| over this archive, lowest first. Files of a layer
+  // shadow the ones at the same paths below it, a ".wh.<name>" whiteout
+  // entry hides <name> of the layers below and ".wh..wh..opq" all entries
+  // of its directory. The merged tree replaces the header, so lookups cost
+  // the same as in a single archive. Must be called once, after Init and
+  // before the archive is shared.
+  void SetLayers(std::vector<std::shared_ptr<Archive>> layers);
+
+  // Whether the file at path() or at the path of a layer is no longer the
+  // one opened by Init, i.e. it was replaced or modified since, or the
+  // opened file itself was modified.
+  bool IsStale() const;
 
   fs::path path() const { return path_; }
 
  private:
+  // Device, inode, size and modification time of the archive file.
+  struct Identity {
+    uint64_t dev = 0U;
+    uint64_t ino = 0U;
+    uint64_t size = 0U;
+    int64_t mtime_ns = 0;
+    bool operator==(const Identity& other) const;
+  };
+
+  // Reads the identity of the opened file, or of the file currently at
+  // |path_| with |from_path|.
+  bool ReadIdentity(Identity* identity, bool from_path = false) const;
+
+  // The archive holding the data of |info|, a layer for files of overlays.
+  const Archive& Owner(const FileInfo& info) const;
+
+  bool FillFileInfo(const nlohmann::json* node, FileInfo* info) const;
+  // Same for the entry at |index| of a binary header.
+  bool FillFileInfo(uint32_t index, FileInfo* info) const;
+
+  // Maps and checks a binary header of |size| bytes, see BinaryHeader.
+  bool InitBinaryHeader(uint32_t size);
+
+  // Whether the header is loaded, either format.
+  bool has_header() const { return binary_.valid() || !header_.is_null(); }
+
+  // Finds the entry at |path| in a binary header the way GetNodeFromPath
+  // finds the node in a JSON one: links are followed for the directories
+  // along the path, not for the entry itself.
+  uint32_t FindBinaryEntry(std::string_view path, uint32_t depth = 0) const;
+
+  // Flattens a JSON header tree into |index_|.
+  void BuildIndex();
+
+  // Gets the index of the directory at |path|, following links.
+  bool FindDirectory(const fs::path& path, uint32_t* index) const;
+
+  void WalkDirectory(uint32_t index,
+                     std::string* prefix,
+                     uint32_t depth,
+                     uint32_t max_depth,
+                     std::vector<WalkEntry>* entries) const;
+
+  // Whether the packed file described by |info| has been validated and the
+  // archive file was not modified since.
+  bool IsVerified(const FileInfo& info) const;
+  void MarkVerified(const FileInfo& info, uint64_t hash_ns) const;
+  bool ValidateAndMarkVerified(const FileInfo& info,
+                               std::string_view content,
+                               unsigned concurrency) const;
+
   std::filesystem::path path_;
   FileReader file_;
   int fd_ = -1;
@@ -108,9 +310,54 @@ class Archive {
   uint32_t header_size_ = 0;
   bool header_validated_ = false;
   nlohmann::json header_;
+  // Used instead of |header_| for archives with a binary header, pointing
+  // into |binary_mapping_|.
+  BinaryHeader binary_;
+  std::unique_ptr<MappedFile> binary_mapping_;
+
+  struct IndexEntry {
+    std::string_view name;
+    FileType type = FileType::kFile;
+    // Children of directories, a contiguous range of |index_|.
+    uint32_t first_child = 0U;
+    uint32_t child_count = 0U;
+    const nlohmann::json* node = nullptr;
+  };
+
+  // The entry at |index|, read from the record of a binary header.
+  IndexEntry GetIndexEntry(uint32_t index) const;
+
+  // All entries of a JSON header in breadth-first order, the root first,
+  // laid out like the records of a binary header. Empty for binary headers.
+  std::vector<IndexEntry> index_;
+  std::unordered_map<const nlohmann::json*, uint32_t> directory_index_;
+
+  // Overlay layers, lowest first, see SetLayers.
+  std::vector<std::shared_ptr<Archive>> layers_;
+
+  // Identity of the file when it was opened, see IsStale.
+  Identity opened_identity_;
+
+  mutable std::mutex identity_lock_;
+  mutable Identity identity_;
+  mutable VerifiedSet verified_;
+
+  struct ExternalFile {
+    std::shared_ptr<ScopedTemporaryFile> file;
+    uint64_t size = 0U;
+    std::list<std::string>::iterator lru;
+  };
+
+  // Removes least recently used files until the limits are met.
+  void EvictExternalFilesLocked();
 
-  std::mutex external_files_lock_;
-  std::unordered_map<std::string, std::unique_ptr<ScopedTemporaryFile>> external_files_;
+  mutable std::mutex external_files_lock_;
+  std::unordered_map<std::string, ExternalFile> external_files_;
+  // Most recently used at front.
+  std::list<std::string> external_files_lru_;
+  uint64_t external_files_bytes_ = 0U;
+  uint64_t max_external_files_bytes_ = 0U;
+  size_t max_external_files_ = 0U;
 };
 
 }  // namespace asar
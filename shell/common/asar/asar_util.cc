@@ -4,60 +4,145 @@
 
 #include "asar_util.h"
 
-#include <map>
+#include <atomic>
+#include <deque>
+#include <shared_mutex>
 #include <memory>
 #include <string>
 #include <filesystem>
 #include <fstream>
 #include <mutex>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <algorithm>
 #include <iomanip>
 #include <sstream>
+#include <cerrno>
 #include <cstdint>
 #include <span>
 #include <iostream>
-#include <openssl/sha.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <limits.h>
+#include <sys/inotify.h>
+#endif
 
 #include "./logger.h"
 #include "./archive.h"
 #include "./asar_util.h"
+#include "./directory_cache.h"
+#include "./integrity.h"
+#include "./path_index.h"
 
 namespace asar {
 
 namespace {
 
-using ArchiveMap = std::map<std::filesystem::path, std::shared_ptr<Archive>>;
+// An opened archive, replaced as a whole when the archive is reloaded. Fds
+// handed out to JS keep their archive open on their own, see
+// ArchiveWrapper::GetFD.
+struct ArchiveEntry {
+    explicit ArchiveEntry(std::shared_ptr<Archive> archive);
+
+    const std::shared_ptr<Archive> archive;
+    // Access epoch of the last lookup, see UnloadIdleAsarArchives.
+    std::atomic<uint64_t> access_epoch;
+    // Steady clock milliseconds before which lookups skip the reload check.
+    std::atomic<int64_t> next_check_ms{0};
+    std::atomic<bool> reloading{false};
+};
+
+// Immutable once published, see GetOrCreateAsarArchive.
+using ArchiveMap = std::unordered_map<std::string, std::shared_ptr<ArchiveEntry>>;
+
+constexpr std::string_view kAsarExtension = ".asar";
+
+std::atomic<bool> g_integrity_validation_enabled{false};
+
+std::atomic<bool> g_reload_enabled{false};
+std::atomic<int64_t> g_reload_check_interval_ms{1000};
+std::atomic<uint64_t> g_reload_count{0};
+// Advanced by every UnloadIdleAsarArchives.
+std::atomic<uint64_t> g_access_epoch{0};
+
+ArchiveEntry::ArchiveEntry(std::shared_ptr<Archive> archive)
+    : archive(std::move(archive)), access_epoch(g_access_epoch.load(std::memory_order_relaxed)) {}
+
+// Marks |entry| as used in the current access epoch. Only the first lookup
+// of an epoch writes.
+void TouchArchive(ArchiveEntry& entry) {
+    const uint64_t epoch = g_access_epoch.load(std::memory_order_relaxed);
+    if (entry.access_epoch.load(std::memory_order_relaxed) != epoch) {
+        entry.access_epoch.store(epoch, std::memory_order_relaxed);
+    }
+}
 
-const std::string kAsarExtension = ".asar";
+#if defined(_WIN32)
+const char kSeparators[] = "\\/";
+#else
+const char kSeparators[] = "/";
+#endif
 
-std::mutex& GetDirectoryCacheMutex() {
-    static std::mutex mutex;
-    return mutex;
+bool IsSeparator(char c) {
+    return std::string_view(kSeparators).find(c) != std::string_view::npos;
 }
 
-std::map<std::filesystem::path, bool>& GetDirectoryCache() {
-    static std::map<std::filesystem::path, bool> cache;
-    return cache;
+// Whether |path| has ".asar" in any case at |pos|, the same rule as the
+// /\.asar/i checks on the JS side.
+bool HasAsarExtensionAt(std::string_view path, size_t pos) {
+    if (path.size() - pos < kAsarExtension.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < kAsarExtension.size(); ++i) {
+        char c = path[pos + i];
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+        if (c != kAsarExtension[i]) {
+            return false;
+        }
+    }
+    return true;
 }
 
-bool IsDirectoryCached(const std::filesystem::path& path) {
-    std::lock_guard<std::mutex> lock(GetDirectoryCacheMutex());
-    auto& cache = GetDirectoryCache();
+// Registered archive paths, the views in |roots| point into |storage|.
+struct ArchiveRoots {
+    std::shared_mutex mutex;
+    std::deque<std::string> storage;
+    std::unordered_set<std::string_view> roots;
+};
 
-    auto it = cache.find(path);
-    if (it != cache.end()) {
-        return it->second;
-    }
+ArchiveRoots& GetArchiveRoots() {
+    static ArchiveRoots archive_roots;
+    return archive_roots;
+}
 
-    std::error_code ec;
-    bool is_directory = std::filesystem::is_directory(path, ec);
-    return cache[path] = (is_directory && !ec);
+// The current snapshot of opened archives. Writers copy it, change the copy
+// and publish it holding GetArchiveCacheMutex. Readers load it atomically and
+// hold it only for the lookup, never while an archive is being opened.
+struct ArchiveCache {
+    std::shared_ptr<const ArchiveMap> map = std::make_shared<const ArchiveMap>();
+};
+
+ArchiveCache& GetArchiveCache() {
+    // Leaked, detached reload and watcher threads may still look up at exit.
+    static ArchiveCache* cache = new ArchiveCache();
+    return *cache;
 }
 
-ArchiveMap& GetArchiveCache() {
-    static ArchiveMap archive_map;
-    return archive_map;
+// Returns the current snapshot. Callers hold no reference past their
+// lookup, so that archives unloaded or replaced meanwhile are released once
+// their last reader is done, idle threads keep none of them alive.
+std::shared_ptr<const ArchiveMap> LoadArchiveCache() {
+    return std::atomic_load_explicit(&GetArchiveCache().map, std::memory_order_acquire);
 }
 
 std::mutex& GetArchiveCacheMutex() {
@@ -65,43 +150,257 @@ std::mutex& GetArchiveCacheMutex() {
     return mutex;
 }
 
-std::string ToHexString(const std::vector<uint8_t>& data) {
-    std::stringstream ss;
-    ss << std::hex << std::setfill('0');
-    for (uint8_t byte : data) {
-        ss << std::setw(2) << static_cast<int>(byte);
+// The current snapshot for writers holding GetArchiveCacheMutex.
+const ArchiveMap& GetArchiveCacheLocked() {
+    return *GetArchiveCache().map;
+}
+
+// Publishes |map| in place of the current snapshot, must be called holding
+// GetArchiveCacheMutex.
+void PublishArchiveCacheLocked(std::shared_ptr<const ArchiveMap> map) {
+    std::atomic_store_explicit(&GetArchiveCache().map, std::move(map), std::memory_order_release);
+}
+
+// Unloaded archives, to tell when they are actually released. Guarded by
+// GetArchiveCacheMutex.
+std::vector<std::weak_ptr<Archive>>& GetUnloadedArchives() {
+    static std::vector<std::weak_ptr<Archive>> unloaded;
+    return unloaded;
+}
+
+void PruneUnloadedArchivesLocked() {
+    std::vector<std::weak_ptr<Archive>>& unloaded = GetUnloadedArchives();
+    unloaded.erase(std::remove_if(unloaded.begin(), unloaded.end(),
+                                  [](const std::weak_ptr<Archive>& archive) { return archive.expired(); }),
+                   unloaded.end());
+}
+
+std::string GetArchiveCacheKey(const std::filesystem::path& path) {
+#if defined(_WIN32)
+    // Both separators are accepted on Windows.
+    return path.lexically_normal().string();
+#else
+    return path.string();
+#endif
+}
+
+std::shared_ptr<ArchiveEntry> FindArchive(const ArchiveMap& map, const std::string& key) {
+    auto it = map.find(key);
+    return it == map.end() ? nullptr : it->second;
+}
+
+// Overlay layers by the cache key of their base archive.
+struct ArchiveLayers {
+    std::mutex mutex;
+    std::unordered_map<std::string, std::vector<std::filesystem::path>> layers;
+};
+
+ArchiveLayers& GetArchiveLayers() {
+    static ArchiveLayers archive_layers;
+    return archive_layers;
+}
+
+// Opens and initializes the archive at |path| with its overlay layers. An
+// overlay whose layer fails to open fails as a whole rather than serving
+// unpatched files.
+std::shared_ptr<Archive> OpenArchive(const std::string& key, const std::filesystem::path& path) {
+    auto archive = std::make_shared<Archive>(path);
+    if (!archive->Init()) {
+        return nullptr;
+    }
+
+    std::vector<std::filesystem::path> layer_paths;
+    {
+        ArchiveLayers& archive_layers = GetArchiveLayers();
+        std::lock_guard<std::mutex> lock(archive_layers.mutex);
+        auto it = archive_layers.layers.find(key);
+        if (it != archive_layers.layers.end()) {
+            layer_paths = it->second;
+        }
+    }
+    if (layer_paths.empty()) {
+        return archive;
+    }
+
+    std::vector<std::shared_ptr<Archive>> layers;
+    for (const auto& layer_path : layer_paths) {
+        auto layer = std::make_shared<Archive>(layer_path);
+        if (!layer->Init()) {
+            LOG_ERROR("Failed to open overlay layer " + layer_path.string() + " of " + key);
+            return nullptr;
+        }
+        layers.push_back(std::move(layer));
+    }
+    archive->SetLayers(std::move(layers));
+    return archive;
+}
+
+int64_t SteadyNowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Initializes the archive at the path of |entry| again and publishes it in
+// place of |entry|, unless |entry| was replaced or removed meanwhile.
+void ReloadArchive(const std::string& key, const std::shared_ptr<ArchiveEntry>& entry) {
+    std::shared_ptr<Archive> archive = OpenArchive(key, entry->archive->path());
+    if (!archive) {
+        LOG_WARNING("Failed to reload archive, keeping the opened one: " + key);
+        // Try again after the next check interval.
+        entry->reloading = false;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(GetArchiveCacheMutex());
+    const ArchiveMap& snapshot = GetArchiveCacheLocked();
+    if (FindArchive(snapshot, key) != entry) {
+        return;
+    }
+    PathIndex::GetInstance().AddArchive(key, *archive);
+    auto updated = std::make_shared<ArchiveMap>(snapshot);
+    (*updated)[key] = std::make_shared<ArchiveEntry>(std::move(archive));
+    PublishArchiveCacheLocked(std::move(updated));
+    g_reload_count.fetch_add(1, std::memory_order_relaxed);
+    LOG_INFO("Archive reloaded: " + key);
+}
+
+// Reloads |entry| on a background thread if its file was replaced.
+void ReloadIfStale(const std::string& key, const std::shared_ptr<ArchiveEntry>& entry) {
+    if (!entry->archive->IsStale() || entry->reloading.exchange(true)) {
+        return;
     }
-    return ss.str();
+    std::thread([key, entry]() { ReloadArchive(key, entry); }).detach();
 }
 
-std::string ToLowerCase(const std::string& str) {
-    std::string result = str;
-    std::transform(result.begin(), result.end(), result.begin(), ::tolower);
-    return result;
+// Checks |entry| for a reload at most once per check interval.
+void MaybeReloadArchive(const std::string& key, const std::shared_ptr<ArchiveEntry>& entry) {
+    const int64_t now = SteadyNowMs();
+    int64_t next_check = entry->next_check_ms.load(std::memory_order_relaxed);
+    if (now < next_check) {
+        return;
+    }
+    // Only the thread that moves the deadline checks.
+    if (!entry->next_check_ms.compare_exchange_strong(next_check, now + g_reload_check_interval_ms)) {
+        return;
+    }
+    ReloadIfStale(key, entry);
+}
+
+// Watches the directories of opened archives with inotify, so that replaced
+// archives are reloaded without waiting for the next lookup.
+struct ArchiveWatcher {
+    std::mutex mutex;
+    bool enabled = false;
+    int fd = -1;
+    // Watched directories by watch descriptor.
+    std::unordered_map<int, std::string> dirs;
+    std::unordered_set<std::string> watched;
+};
+
+ArchiveWatcher& GetArchiveWatcher() {
+    static ArchiveWatcher watcher;
+    return watcher;
 }
 
-std::vector<uint8_t> Sha256Hash(std::string_view data) {
-    std::vector<uint8_t> hash(SHA256_DIGEST_LENGTH);
-    SHA256(reinterpret_cast<const unsigned char*>(data.data()), data.size(), hash.data());
-    return hash;
+void RunArchiveWatcher() {
+#if defined(__linux__)
+    ArchiveWatcher& watcher = GetArchiveWatcher();
+    std::vector<char> buf(16 * (sizeof(struct inotify_event) + NAME_MAX + 1));
+    while (true) {
+        const ssize_t length = read(watcher.fd, buf.data(), buf.size());
+        if (length <= 0) {
+            if (length < 0 && errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+
+        for (ssize_t offset = 0; offset < length;) {
+            const auto* event = reinterpret_cast<const struct inotify_event*>(buf.data() + offset);
+            offset += sizeof(struct inotify_event) + event->len;
+            if (event->len == 0 || !g_reload_enabled) {
+                continue;
+            }
+
+            std::string dir;
+            {
+                std::lock_guard<std::mutex> lock(watcher.mutex);
+                auto it = watcher.dirs.find(event->wd);
+                if (it == watcher.dirs.end()) {
+                    continue;
+                }
+                dir = it->second;
+            }
+
+            const std::string key = GetArchiveCacheKey(std::filesystem::path(dir) / event->name);
+            if (std::shared_ptr<ArchiveEntry> entry = FindArchive(*LoadArchiveCache(), key)) {
+                ReloadIfStale(key, entry);
+            }
+        }
+    }
+#endif
+}
+
+// Starts watching the directory of the archive at |path| if enabled.
+void WatchArchive(const std::filesystem::path& path) {
+#if defined(__linux__)
+    ArchiveWatcher& watcher = GetArchiveWatcher();
+    std::lock_guard<std::mutex> lock(watcher.mutex);
+    const std::string dir = path.parent_path().string();
+    if (!watcher.enabled || watcher.watched.count(dir)) {
+        return;
+    }
+
+    if (watcher.fd < 0) {
+        watcher.fd = inotify_init1(IN_CLOEXEC);
+        if (watcher.fd < 0) {
+            LOG_WARNING("inotify is not available, archive reloads rely on lookups");
+            watcher.enabled = false;
+            return;
+        }
+        std::thread(RunArchiveWatcher).detach();
+    }
+
+    // Renames over the archive and writes to it in place.
+    const int wd = inotify_add_watch(watcher.fd, dir.c_str(),
+                                     IN_MOVED_TO | IN_CREATE | IN_CLOSE_WRITE | IN_ONLYDIR);
+    if (wd < 0) {
+        return;
+    }
+    watcher.dirs[wd] = dir;
+    watcher.watched.insert(dir);
+#endif
 }
 
 }  // namespace
 
 std::shared_ptr<Archive> GetOrCreateAsarArchive(const std::filesystem::path& path) {
-    std::lock_guard<std::mutex> lock(GetArchiveCacheMutex());
-    ArchiveMap& map = GetArchiveCache();
+    const std::string key = GetArchiveCacheKey(path);
 
     // if we have it, return it
-    const auto lower = map.lower_bound(path);
-    if (lower != map.end() && lower->first == path) {
-        return lower->second;
+    if (std::shared_ptr<ArchiveEntry> entry = FindArchive(*LoadArchiveCache(), key)) {
+        TouchArchive(*entry);
+        if (g_reload_enabled.load(std::memory_order_relaxed)) {
+            MaybeReloadArchive(key, entry);
+        }
+        return entry->archive;
+    }
+
+    // Creation is serialized so that every archive is initialized only once,
+    // look again in case another thread created it meanwhile.
+    std::lock_guard<std::mutex> lock(GetArchiveCacheMutex());
+    const ArchiveMap& snapshot = GetArchiveCacheLocked();
+    if (std::shared_ptr<ArchiveEntry> entry = FindArchive(snapshot, key)) {
+        return entry->archive;
     }
 
     // if we can create it, return it
-    auto archive = std::make_shared<Archive>(path);
-    if (archive->Init()) {
-        map.try_emplace(lower, path, archive);
+    if (std::shared_ptr<Archive> archive = OpenArchive(key, path)) {
+        PathIndex::GetInstance().AddArchive(key, *archive);
+        auto updated = std::make_shared<ArchiveMap>(snapshot);
+        updated->emplace(key, std::make_shared<ArchiveEntry>(archive));
+        PublishArchiveCacheLocked(std::move(updated));
+        WatchArchive(path);
         return archive;
     }
 
@@ -109,16 +408,194 @@ std::shared_ptr<Archive> GetOrCreateAsarArchive(const std::filesystem::path& pat
     return nullptr;
 }
 
+void SetArchiveLayers(const std::filesystem::path& path, std::vector<std::filesystem::path> layers) {
+    const std::string key = GetArchiveCacheKey(path);
+    {
+        ArchiveLayers& archive_layers = GetArchiveLayers();
+        std::lock_guard<std::mutex> lock(archive_layers.mutex);
+        if (layers.empty()) {
+            archive_layers.layers.erase(key);
+        } else {
+            archive_layers.layers[key] = std::move(layers);
+        }
+    }
+    UnloadAsarArchive(path);
+}
+
+void SetPathIndexEnabled(bool enabled) {
+    std::vector<std::string> roots;
+    {
+        std::lock_guard<std::mutex> lock(GetArchiveCacheMutex());
+        PathIndex::GetInstance().SetEnabled(enabled);
+        if (!enabled) {
+            return;
+        }
+        for (const auto& [key, entry] : GetArchiveCacheLocked()) {
+            PathIndex::GetInstance().AddArchive(key, *entry->archive);
+        }
+    }
+
+    {
+        ArchiveRoots& archive_roots = GetArchiveRoots();
+        std::shared_lock<std::shared_mutex> lock(archive_roots.mutex);
+        roots.assign(archive_roots.storage.begin(), archive_roots.storage.end());
+    }
+    for (const auto& root : roots) {
+        GetOrCreateAsarArchive(std::filesystem::path(root));
+    }
+}
+
+std::shared_ptr<Archive> UnloadAsarArchive(const std::filesystem::path& path) {
+    const std::string key = GetArchiveCacheKey(path);
+
+    std::lock_guard<std::mutex> lock(GetArchiveCacheMutex());
+    const ArchiveMap& snapshot = GetArchiveCacheLocked();
+    std::shared_ptr<ArchiveEntry> entry = FindArchive(snapshot, key);
+    if (!entry) {
+        return nullptr;
+    }
+
+    PathIndex::GetInstance().RemoveArchive(key);
+    auto updated = std::make_shared<ArchiveMap>(snapshot);
+    updated->erase(key);
+    PublishArchiveCacheLocked(std::move(updated));
+
+    PruneUnloadedArchivesLocked();
+    GetUnloadedArchives().push_back(entry->archive);
+    return entry->archive;
+}
+
+std::vector<std::string> UnloadIdleAsarArchives(const std::vector<fs::path>& used) {
+    std::lock_guard<std::mutex> lock(GetArchiveCacheMutex());
+    const ArchiveMap& snapshot = GetArchiveCacheLocked();
+    for (const auto& path : used) {
+        if (std::shared_ptr<ArchiveEntry> entry = FindArchive(snapshot, GetArchiveCacheKey(path))) {
+            TouchArchive(*entry);
+        }
+    }
+
+    PathIndex& index = PathIndex::GetInstance();
+    const uint64_t epoch = g_access_epoch.load(std::memory_order_relaxed);
+    std::vector<std::string> unloaded;
+    std::shared_ptr<ArchiveMap> updated;
+    for (const auto& [key, entry] : snapshot) {
+        if (entry->access_epoch.load(std::memory_order_relaxed) == epoch || index.WasAccessed(key)) {
+            continue;
+        }
+        if (!updated) {
+            updated = std::make_shared<ArchiveMap>(snapshot);
+            PruneUnloadedArchivesLocked();
+        }
+        index.RemoveArchive(key);
+        updated->erase(key);
+        GetUnloadedArchives().push_back(entry->archive);
+        unloaded.push_back(key);
+    }
+    if (updated) {
+        PublishArchiveCacheLocked(std::move(updated));
+    }
+
+    g_access_epoch.store(epoch + 1, std::memory_order_relaxed);
+    index.AdvanceAccessEpoch();
+    return unloaded;
+}
+
+std::vector<std::shared_ptr<Archive>> GetOpenedAsarArchives() {
+    const std::shared_ptr<const ArchiveMap> snapshot = LoadArchiveCache();
+    std::vector<std::shared_ptr<Archive>> archives;
+    archives.reserve(snapshot->size());
+    for (const auto& [key, entry] : *snapshot) {
+        archives.push_back(entry->archive);
+    }
+    return archives;
+}
+
+size_t GetPendingUnloadCount() {
+    std::lock_guard<std::mutex> lock(GetArchiveCacheMutex());
+    PruneUnloadedArchivesLocked();
+    return GetUnloadedArchives().size();
+}
+
+void RegisterArchiveRoot(std::string_view path) {
+    ArchiveRoots& archive_roots = GetArchiveRoots();
+    std::unique_lock<std::shared_mutex> lock(archive_roots.mutex);
+    if (archive_roots.roots.count(path)) {
+        return;
+    }
+    archive_roots.storage.emplace_back(path);
+    archive_roots.roots.insert(archive_roots.storage.back());
+    lock.unlock();
+
+    if (PathIndex::GetInstance().enabled()) {
+        GetOrCreateAsarArchive(std::filesystem::path(path));
+    }
+}
+
+bool SplitArchivePath(std::string_view full_path,
+                      std::string_view* asar_path,
+                      std::string_view* relative_path,
+                      bool allow_root) {
+    ArchiveRoots& archive_roots = GetArchiveRoots();
+    std::shared_lock<std::shared_mutex> lock(archive_roots.mutex);
+    if (archive_roots.roots.empty()) {
+        return false;
+    }
+
+    // Find the deepest "*.asar" component that is a registered archive.
+    size_t root_end = std::string_view::npos;
+    for (size_t pos = full_path.find('.'); pos != std::string_view::npos;
+         pos = full_path.find('.', pos + 1)) {
+        const size_t end = pos + kAsarExtension.size();
+        if (!HasAsarExtensionAt(full_path, pos) ||
+            (end != full_path.size() && !IsSeparator(full_path[end]))) {
+            continue;
+        }
+        if (archive_roots.roots.count(full_path.substr(0, end))) {
+            root_end = end;
+        }
+    }
+    if (root_end == std::string_view::npos) {
+        return false;
+    }
+
+    std::string_view tail = full_path.substr(root_end);
+    while (!tail.empty() && IsSeparator(tail.front())) {
+        tail.remove_prefix(1);
+    }
+    while (!tail.empty() && IsSeparator(tail.back())) {
+        tail.remove_suffix(1);
+    }
+    if (tail.empty() && !allow_root) {
+        return false;
+    }
+
+    *asar_path = full_path.substr(0, root_end);
+    *relative_path = tail;
+    return true;
+}
+
 bool GetAsarArchivePath(const std::filesystem::path& full_path,
                         std::filesystem::path* asar_path,
                         std::filesystem::path* relative_path,
                         bool allow_root) {
+    // Registered archives are split lexically, others are found by probing
+    // the filesystem.
+    const std::string full_path_str = full_path.string();
+    std::string_view asar_view, relative_view;
+    if (SplitArchivePath(full_path_str, &asar_view, &relative_view, allow_root)) {
+        *asar_path = std::filesystem::path(asar_view);
+        *relative_path = std::filesystem::path(relative_view);
+        return true;
+    }
+
     std::filesystem::path iter = full_path;
 
     while (true) {
         std::filesystem::path dirname = iter.parent_path();
 
-        if (iter.extension() == kAsarExtension && !IsDirectoryCached(iter)) {
+        const std::string extension = iter.extension().string();
+        if (extension.size() == kAsarExtension.size() && HasAsarExtensionAt(extension, 0) &&
+            !DirectoryCache::GetInstance().IsDirectory(iter)) {
             break;
         } else if (iter == dirname) {
             return false;
@@ -143,6 +620,43 @@ bool GetAsarArchivePath(const std::filesystem::path& full_path,
     return true;
 }
 
+void SetIntegrityValidationEnabled(bool enabled) {
+    g_integrity_validation_enabled = enabled;
+}
+
+bool IsIntegrityValidationEnabled() {
+    return g_integrity_validation_enabled;
+}
+
+void SetArchiveReloadOptions(bool enabled,
+                             std::chrono::milliseconds check_interval,
+                             bool watch) {
+    g_reload_check_interval_ms = check_interval.count();
+    g_reload_enabled = enabled;
+
+    {
+        ArchiveWatcher& watcher = GetArchiveWatcher();
+        std::lock_guard<std::mutex> lock(watcher.mutex);
+        watcher.enabled = enabled && watch;
+    }
+    if (!enabled || !watch) {
+        return;
+    }
+    // Watch the archives opened before.
+    const std::shared_ptr<const ArchiveMap> snapshot = LoadArchiveCache();
+    for (const auto& [key, entry] : *snapshot) {
+        WatchArchive(entry->archive->path());
+    }
+}
+
+bool IsArchiveReloadEnabled() {
+    return g_reload_enabled;
+}
+
+uint64_t GetArchiveReloadCount() {
+    return g_reload_count;
+}
+
 bool ReadFileToString(const std::filesystem::path& path, std::string* contents) {
     std::filesystem::path asar_path, relative_path;
     if (!GetAsarArchivePath(path, &asar_path, &relative_path)) {
@@ -179,41 +693,149 @@ bool ReadFileToString(const std::filesystem::path& path, std::string* contents)
         return ReadFileToString(real_path, contents);
     }
 
-    std::ifstream src(asar_path, std::ios::binary);
-    if (!src.is_open()) {
-        return false;
+    contents->resize(info.size);
+    switch (archive->ReadFile(info, contents->data())) {
+        case Archive::ReadResult::kSuccess:
+            return true;
+        case Archive::ReadResult::kIntegrityFailed:
+            std::abort();
+        default:
+            return false;
     }
+}
 
-    contents->resize(info.size);
-    src.seekg(info.offset);
-    src.read(contents->data(), info.size);
+bool ValidateIntegrity(std::string_view input, const IntegrityPayload& integrity) {
+    if (integrity.algorithm == HashAlgorithm::kSHA256) {
+        const std::string hex_hash = Sha256Hex(input);
 
-    if (!src.good() && !src.eof()) {
-        return false;
+        if (integrity.hash != hex_hash) {
+            LOG_ERROR("Integrity check failed for asar archive (" + integrity.hash + " vs " + hex_hash + ")");
+            return false;
+        }
+        return true;
     }
 
-    if (info.integrity) {
-        ValidateIntegrityOrDie(std::string_view(
-            (contents->data()),
-            contents->size()), *info.integrity);
+    LOG_ERROR("Unsupported hashing algorithm in ValidateIntegrity");
+    return false;
+}
+
+void ValidateIntegrityOrDie(std::string_view input, const IntegrityPayload& integrity) {
+    if (!ValidateIntegrity(input, integrity)) {
+        std::abort();
+    }
+}
+
+bool ReadFromFD(int fd, uint64_t offset, char* buf, size_t size) {
+    if (fd < 0) {
+        return false;
     }
 
+#if defined(_WIN32)
+    // There is no pread on Windows, serialize seek + read instead.
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (_lseeki64(fd, offset, SEEK_SET) == -1) {
+        return false;
+    }
+    while (size > 0) {
+        int bytes_read = _read(fd, buf, static_cast<unsigned int>(size));
+        if (bytes_read <= 0) {
+            return false;
+        }
+        buf += bytes_read;
+        size -= bytes_read;
+    }
+#else
+    while (size > 0) {
+        ssize_t bytes_read = pread(fd, buf, size, offset);
+        if (bytes_read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes_read <= 0) {
+            return false;
+        }
+        buf += bytes_read;
+        size -= bytes_read;
+        offset += bytes_read;
+    }
+#endif
     return true;
 }
 
-void ValidateIntegrityOrDie(std::string_view input, const IntegrityPayload& integrity) {
-    if (integrity.algorithm == HashAlgorithm::kSHA256) {
-        const std::vector<uint8_t> hash_bytes = Sha256Hash(input);
-        const std::string hex_hash = ToLowerCase(ToHexString(hash_bytes));
+bool WriteToFD(int fd, uint64_t offset, const char* buf, size_t size) {
+    if (fd < 0) {
+        return false;
+    }
 
-        if (integrity.hash != hex_hash) {
-            LOG_ERROR("Integrity check failed for asar archive (" + integrity.hash + " vs " + hex_hash + ")");
-            std::abort();
+#if defined(_WIN32)
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (_lseeki64(fd, offset, SEEK_SET) == -1) {
+        return false;
+    }
+    while (size > 0) {
+        int bytes_written = _write(fd, buf, static_cast<unsigned int>(size));
+        if (bytes_written <= 0) {
+            return false;
         }
-    } else {
-        LOG_ERROR("Unsupported hashing algorithm  in ValidateIntegrityOrDie");
-        std::abort();
+        buf += bytes_written;
+        size -= bytes_written;
+    }
+#else
+    while (size > 0) {
+        ssize_t bytes_written = pwrite(fd, buf, size, offset);
+        if (bytes_written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes_written <= 0) {
+            return false;
+        }
+        buf += bytes_written;
+        size -= bytes_written;
+        offset += bytes_written;
+    }
+#endif
+    return true;
+}
+
+bool ParallelFor(size_t count,
+                 unsigned concurrency,
+                 const std::function<bool(size_t)>& fn) {
+    if (concurrency == 0) {
+        concurrency = std::max(1U, std::thread::hardware_concurrency());
+    }
+    concurrency = static_cast<unsigned>(std::min<size_t>(concurrency, count));
+
+    std::atomic<size_t> next{0};
+    std::atomic<bool> ok{true};
+    auto worker = [&]() {
+        while (ok.load(std::memory_order_relaxed)) {
+            size_t index = next.fetch_add(1, std::memory_order_relaxed);
+            if (index >= count) {
+                break;
+            }
+            if (!fn(index)) {
+                ok = false;
+            }
+        }
+    };
+
+    if (concurrency <= 1) {
+        worker();
+        return ok;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(concurrency - 1);
+    for (unsigned i = 1; i < concurrency; ++i) {
+        threads.emplace_back(worker);
+    }
+    // The calling thread takes a share of the work too.
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
     }
+    return ok;
 }
 
 }  // namespace asar
\ No newline at end of file
@@ -5,8 +5,13 @@
 #ifndef ELECTRON_SHELL_COMMON_ASAR_ASAR_UTIL_H_
 #define ELECTRON_SHELL_COMMON_ASAR_ASAR_UTIL_H_
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <filesystem>
 namespace fs = std::filesystem;
 namespace asar {
@@ -17,18 +22,95 @@ struct IntegrityPayload;
 // Gets or creates and caches a new Archive from the path.
 std::shared_ptr<Archive> GetOrCreateAsarArchive(const fs::path& path);
 
+// Opens the archive at |path| as an overlay of |layers|, lowest first, see
+// Archive::SetLayers. Takes effect the next time the archive is opened, an
+// opened one is unloaded. Empty |layers| turn the overlay off.
+void SetArchiveLayers(const fs::path& path, std::vector<fs::path> layers);
+
+// Enables the process wide PathIndex of opened archives. Registered
+// archives are then opened right away, as they are registered, so that
+// their paths are indexed.
+void SetPathIndexEnabled(bool enabled);
+
+// Forgets the opened archive at |path|, it is opened again by the next
+// lookup. Its header, index, fd, mapping and extracted files are released
+// once the last reference to it is gone. Returns the unloaded archive, or
+// nullptr if none was opened at |path|.
+std::shared_ptr<Archive> UnloadAsarArchive(const fs::path& path);
+
+// Unloads the opened archives that were not looked up, either by
+// GetOrCreateAsarArchive or through the PathIndex, since the previous call,
+// see UnloadAsarArchive. |used| are archives that were accessed through an
+// Archive held by the caller. Returns the keys of the unloaded archives.
+std::vector<std::string> UnloadIdleAsarArchives(const std::vector<fs::path>& used);
+
+// The archives currently opened.
+std::vector<std::shared_ptr<Archive>> GetOpenedAsarArchives();
+
+// Number of unloaded archives still kept alive by a reference.
+size_t GetPendingUnloadCount();
+
+// Enables reloading opened archives whose file was replaced or modified.
+// Lookups check the file at most every |check_interval|, and with |watch|
+// on Linux inotify triggers the check as soon as the file changes. The new
+// Archive is initialized in the background and published atomically, the
+// replaced one stays alive while referenced and until the next reload of
+// the same path, so that fds handed out by it remain valid.
+void SetArchiveReloadOptions(bool enabled,
+                             std::chrono::milliseconds check_interval,
+                             bool watch);
+bool IsArchiveReloadEnabled();
+
+// Number of archives replaced by reloads.
+uint64_t GetArchiveReloadCount();
+
+// Registers |path| as an archive, paths inside it are then split lexically
+// by SplitArchivePath without touching the filesystem.
+void RegisterArchiveRoot(std::string_view path);
+
+// Splits a normalized |full_path| into the registered archive containing it
+// and the path inside the archive. Makes no syscalls and no allocations, the
+// results point into |full_path|.
+bool SplitArchivePath(std::string_view full_path,
+                      std::string_view* asar_path,
+                      std::string_view* relative_path,
+                      bool allow_root = false);
+
 // Separates the path to Archive out.
 bool GetAsarArchivePath(const fs::path& full_path,
                         fs::path* asar_path,
                         fs::path* relative_path,
                         bool allow_root = false);
 
+// Enables validating file contents against the integrity info in the header
+// of archives initialized afterwards. Without an embedded header hash to
+// check the header itself against, enabling this trusts the header.
+void SetIntegrityValidationEnabled(bool enabled);
+bool IsIntegrityValidationEnabled();
+
 // Same with base::ReadFileToString but supports asar Archive.
 bool ReadFileToString(const fs::path& path, std::string* contents);
 
 void ValidateIntegrityOrDie(std::string_view input,
                             const IntegrityPayload& integrity);
 
+// Same with ValidateIntegrityOrDie but returns false on mismatch.
+bool ValidateIntegrity(std::string_view input,
+                       const IntegrityPayload& integrity);
+
+// Reads |size| bytes at |offset| of |fd| into |buf|, does not move the file
+// position so it can be called from multiple threads.
+bool ReadFromFD(int fd, uint64_t offset, char* buf, size_t size);
+
+// Writes |size| bytes of |buf| at |offset| of |fd|, like ReadFromFD.
+bool WriteToFD(int fd, uint64_t offset, const char* buf, size_t size);
+
+// Runs |fn| for every index in [0, count) on up to |concurrency| threads,
+// stops handing out new indexes once |fn| returns false.
+bool ParallelFor(size_t count,
+                 unsigned concurrency,
+                 const std::function<bool(size_t)>& fn);
+
 }  // namespace asar
 
 #endif  // ELECTRON_SHELL_COMMON_ASAR_ASAR_UTIL_H_
@@ -0,0 +1,391 @@
+#include "binary_header.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace asar {
+
+namespace {
+
+static_assert(sizeof(BinaryHeader::Prefix) == 32, "Prefix is part of the format");
+static_assert(sizeof(BinaryHeader::Record) == 56, "Record is part of the format");
+
+uint64_t AlignTo8(uint64_t size) {
+  return (size + 7) & ~uint64_t{7};
+}
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+bool AppendDigest(const nlohmann::json& hex, std::string* digests) {
+  if (!hex.is_string())
+    return false;
+  const std::string& value = hex.get_ref<const std::string&>();
+  if (value.size() != BinaryHeader::kDigestSize * 2)
+    return false;
+  for (size_t i = 0; i < value.size(); i += 2) {
+    const int high = HexValue(value[i]);
+    const int low = HexValue(value[i + 1]);
+    if (high < 0 || low < 0)
+      return false;
+    digests->push_back(static_cast<char>(high << 4 | low));
+  }
+  return true;
+}
+
+template <typename T>
+void AppendRaw(std::string* out, const T& value) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Fills |record| for the file |node| at |path|.
+bool EncodeFile(const nlohmann::json& node,
+                const std::string& path,
+                BinaryHeader::Record* record,
+                std::string* digests,
+                std::string* error) {
+  record->type = BinaryHeader::kFile;
+  auto size = node.find("size");
+  if (size == node.end() || !size->is_number_unsigned() ||
+      size->get<uint64_t>() > UINT32_MAX) {
+    *error = path + ": invalid size";
+    return false;
+  }
+  record->size = size->get<uint64_t>();
+
+  if (node.value("executable", false))
+    record->flags |= BinaryHeader::kExecutable;
+  if (node.value("unpacked", false)) {
+    record->flags |= BinaryHeader::kUnpacked;
+  } else {
+    auto offset = node.find("offset");
+    const std::string* value = offset != node.end() && offset->is_string()
+                                   ? &offset->get_ref<const std::string&>()
+                                   : nullptr;
+    if (!value ||
+        std::from_chars(value->data(), value->data() + value->size(), record->offset).ptr !=
+            value->data() + value->size()) {
+      *error = path + ": invalid offset";
+      return false;
+    }
+  }
+
+  auto integrity = node.find("integrity");
+  if (integrity == node.end())
+    return true;
+  const auto& payload = *integrity;
+  if (!payload.is_object() || payload.value("algorithm", "") != "SHA256" ||
+      !payload.contains("blockSize") || !payload["blockSize"].is_number_unsigned() ||
+      !payload.contains("blocks") || !payload["blocks"].is_array()) {
+    *error = path + ": invalid integrity";
+    return false;
+  }
+  record->flags |= BinaryHeader::kIntegrity;
+  record->digest = static_cast<uint32_t>(digests->size() / BinaryHeader::kDigestSize);
+  record->block_size = payload["blockSize"].get<uint32_t>();
+  record->block_count = static_cast<uint32_t>(payload["blocks"].size());
+  if (!AppendDigest(payload.value("hash", nlohmann::json()), digests)) {
+    *error = path + ": invalid integrity hash";
+    return false;
+  }
+  for (const auto& block : payload["blocks"]) {
+    if (!AppendDigest(block, digests)) {
+      *error = path + ": invalid integrity block";
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+BinaryHeader::BinaryHeader() = default;
+BinaryHeader::~BinaryHeader() = default;
+
+bool BinaryHeader::Encode(const nlohmann::json& root, std::string* table, std::string* error) {
+  if (!root.is_object() || !root.contains("files")) {
+    *error = "the header has no root directory";
+    return false;
+  }
+
+  std::vector<Record> records;
+  std::vector<const nlohmann::json*> nodes;
+  std::string strings;
+  std::string digests;
+
+  Record root_record = {};
+  root_record.type = kDirectory;
+  records.push_back(root_record);
+  nodes.push_back(&root);
+
+  // Appending the children of each directory in turn keeps them contiguous,
+  // JSON objects iterate in name order.
+  for (size_t i = 0; i < records.size(); ++i) {
+    if (records[i].type != kDirectory)
+      continue;
+    const nlohmann::json& files = (*nodes[i])["files"];
+    if (!files.is_object()) {
+      *error = "invalid directory in the header";
+      return false;
+    }
+    const std::string parent(strings, records[i].path_offset, records[i].path_size);
+    records[i].first_child = static_cast<uint32_t>(records.size());
+    records[i].child_count = static_cast<uint32_t>(files.size());
+    for (const auto& [name, child] : files.items()) {
+      const std::string path = parent.empty() ? name : parent + "/" + name;
+      if (name.empty() || name.find('/') != std::string::npos || !child.is_object()) {
+        *error = path + ": invalid entry";
+        return false;
+      }
+
+      Record record = {};
+      record.path_offset = static_cast<uint32_t>(strings.size());
+      record.path_size = static_cast<uint32_t>(path.size());
+      record.name_size = static_cast<uint32_t>(name.size());
+      strings.append(path);
+
+      if (child.contains("link")) {
+        if (!child["link"].is_string()) {
+          *error = path + ": invalid link";
+          return false;
+        }
+        const std::string& target = child["link"].get_ref<const std::string&>();
+        record.type = kLink;
+        record.offset = strings.size();
+        record.size = target.size();
+        strings.append(target);
+      } else if (child.contains("files")) {
+        record.type = kDirectory;
+      } else if (!EncodeFile(child, path, &record, &digests, error)) {
+        return false;
+      }
+      if (strings.size() > UINT32_MAX || records.size() >= UINT32_MAX) {
+        *error = "header too large";
+        return false;
+      }
+      records.push_back(record);
+      nodes.push_back(&child);
+    }
+  }
+
+  std::vector<uint32_t> sorted(records.size());
+  for (uint32_t i = 0; i < sorted.size(); ++i)
+    sorted[i] = i;
+  auto path_of = [&](uint32_t index) {
+    return std::string_view(strings).substr(records[index].path_offset, records[index].path_size);
+  };
+  std::sort(sorted.begin(), sorted.end(),
+            [&](uint32_t a, uint32_t b) { return path_of(a) < path_of(b); });
+
+  Prefix prefix = {};
+  prefix.version = kVersion;
+  prefix.entry_count = static_cast<uint32_t>(records.size());
+  prefix.digest_count = static_cast<uint32_t>(digests.size() / kDigestSize);
+  prefix.strings_size = strings.size();
+  prefix.table_size = sizeof(Prefix) + records.size() * sizeof(Record) +
+                      AlignTo8(sorted.size() * sizeof(uint32_t)) + digests.size() +
+                      AlignTo8(strings.size());
+
+  table->clear();
+  table->reserve(prefix.table_size);
+  AppendRaw(table, prefix);
+  table->append(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+  table->append(reinterpret_cast<const char*>(sorted.data()), sorted.size() * sizeof(uint32_t));
+  table->resize(AlignTo8(table->size()), '\0');
+  table->append(digests);
+  table->append(strings);
+  table->resize(AlignTo8(table->size()), '\0');
+  return true;
+}
+
+bool BinaryHeader::Init(const char* data, uint64_t size) {
+  Reset();
+  if (reinterpret_cast<uintptr_t>(data) % 8 != 0 || size < sizeof(Prefix))
+    return false;
+
+  const Prefix* prefix = reinterpret_cast<const Prefix*>(data);
+  const uint64_t count = prefix->entry_count;
+  const uint64_t records_end = sizeof(Prefix) + count * sizeof(Record);
+  const uint64_t sorted_end = records_end + AlignTo8(count * sizeof(uint32_t));
+  const uint64_t digests_end = sorted_end + uint64_t{prefix->digest_count} * kDigestSize;
+  if (prefix->version != kVersion || count == 0 || prefix->strings_size > UINT32_MAX ||
+      prefix->table_size != digests_end + AlignTo8(prefix->strings_size) ||
+      prefix->table_size > size)
+    return false;
+
+  const Record* records = reinterpret_cast<const Record*>(data + sizeof(Prefix));
+  const uint32_t* sorted = reinterpret_cast<const uint32_t*>(data + records_end);
+  const char* strings = data + digests_end;
+  const std::string_view all_strings(strings, prefix->strings_size);
+  auto path_of = [&](uint64_t index) {
+    return all_strings.substr(records[index].path_offset, records[index].path_size);
+  };
+
+  if (records[0].type != kDirectory || records[0].path_size != 0)
+    return false;
+  for (uint64_t i = 0; i < count; ++i) {
+    const Record& record = records[i];
+    if (uint64_t{record.path_offset} + record.path_size > prefix->strings_size ||
+        record.name_size > record.path_size)
+      return false;
+    switch (record.type) {
+      case kDirectory: {
+        // Children come after their parent, so walks always end.
+        if (record.child_count > 0 &&
+            (record.first_child <= i || uint64_t{record.first_child} + record.child_count > count))
+          return false;
+        for (uint64_t child = uint64_t{record.first_child} + 1;
+             child < uint64_t{record.first_child} + record.child_count; ++child) {
+          const Record& a = records[child - 1];
+          const Record& b = records[child];
+          if (uint64_t{a.path_offset} + a.path_size > prefix->strings_size ||
+              uint64_t{b.path_offset} + b.path_size > prefix->strings_size ||
+              a.name_size > a.path_size || b.name_size > b.path_size ||
+              path_of(child - 1).substr(a.path_size - a.name_size) >=
+                  path_of(child).substr(b.path_size - b.name_size))
+            return false;
+        }
+        break;
+      }
+      case kLink:
+        if (record.offset + record.size > prefix->strings_size ||
+            record.offset + record.size < record.offset)
+          return false;
+        break;
+      case kFile:
+        if (record.size > UINT32_MAX ||
+            ((record.flags & kIntegrity) &&
+             uint64_t{record.digest} + 1 + record.block_count > prefix->digest_count))
+          return false;
+        break;
+      default:
+        return false;
+    }
+  }
+  for (uint64_t i = 0; i < count; ++i) {
+    if (sorted[i] >= count || (i > 0 && path_of(sorted[i - 1]) >= path_of(sorted[i])))
+      return false;
+  }
+
+  prefix_ = prefix;
+  records_ = records;
+  sorted_ = sorted;
+  digests_ = reinterpret_cast<const uint8_t*>(data + sorted_end);
+  strings_ = strings;
+  return true;
+}
+
+void BinaryHeader::Reset() {
+  prefix_ = nullptr;
+  records_ = nullptr;
+  sorted_ = nullptr;
+  digests_ = nullptr;
+  strings_ = nullptr;
+}
+
+std::string_view BinaryHeader::path(uint32_t index) const {
+  return std::string_view(strings_ + records_[index].path_offset, records_[index].path_size);
+}
+
+std::string_view BinaryHeader::name(uint32_t index) const {
+  const Record& record = records_[index];
+  return std::string_view(strings_ + record.path_offset + record.path_size - record.name_size,
+                          record.name_size);
+}
+
+std::string_view BinaryHeader::link(uint32_t index) const {
+  return std::string_view(strings_ + records_[index].offset, records_[index].size);
+}
+
+std::string BinaryHeader::DigestHex(uint32_t digest) const {
+  static const char kHexChars[] = "0123456789abcdef";
+  const uint8_t* bytes = digests_ + uint64_t{digest} * kDigestSize;
+  std::string hex(kDigestSize * 2, '0');
+  for (size_t i = 0; i < kDigestSize; ++i) {
+    hex[i * 2] = kHexChars[bytes[i] >> 4];
+    hex[i * 2 + 1] = kHexChars[bytes[i] & 0xf];
+  }
+  return hex;
+}
+
+uint32_t BinaryHeader::FindPath(std::string_view path) const {
+  const uint32_t* end = sorted_ + prefix_->entry_count;
+  const uint32_t* it = std::lower_bound(sorted_, end, path, [this](uint32_t index, std::string_view value) {
+    return this->path(index) < value;
+  });
+  if (it == end || this->path(*it) != path)
+    return kNotFound;
+  return *it;
+}
+
+uint32_t BinaryHeader::FindChild(uint32_t index, std::string_view name) const {
+  const Record& dir = records_[index];
+  if (dir.type != kDirectory)
+    return kNotFound;
+  uint32_t low = dir.first_child;
+  uint32_t high = dir.first_child + dir.child_count;
+  while (low < high) {
+    const uint32_t middle = low + (high - low) / 2;
+    const std::string_view middle_name = this->name(middle);
+    if (middle_name == name)
+      return middle;
+    if (middle_name < name)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return kNotFound;
+}
+
+nlohmann::json BinaryHeader::ToJson() const {
+  return RecordToJson(0);
+}
+
+nlohmann::json BinaryHeader::RecordToJson(uint32_t index) const {
+  const Record& record = records_[index];
+  nlohmann::json node = nlohmann::json::object();
+  switch (record.type) {
+    case kDirectory: {
+      nlohmann::json& files = node["files"] = nlohmann::json::object();
+      for (uint32_t child = record.first_child; child < record.first_child + record.child_count; ++child)
+        files[std::string(name(child))] = RecordToJson(child);
+      break;
+    }
+    case kLink:
+      node["link"] = std::string(link(index));
+      break;
+    case kFile:
+      node["size"] = record.size;
+      if (record.flags & kUnpacked)
+        node["unpacked"] = true;
+      else
+        node["offset"] = std::to_string(record.offset);
+      if (record.flags & kExecutable)
+        node["executable"] = true;
+      if (record.flags & kIntegrity) {
+        nlohmann::json blocks = nlohmann::json::array();
+        for (uint32_t block = 0; block < record.block_count; ++block)
+          blocks.push_back(DigestHex(record.digest + 1 + block));
+        node["integrity"] = {
+            {"algorithm", "SHA256"},
+            {"hash", DigestHex(record.digest)},
+            {"blockSize", record.block_size},
+            {"blocks", std::move(blocks)},
+        };
+      }
+      break;
+  }
+  return node;
+}
+
+}  // namespace asar
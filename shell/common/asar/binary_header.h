@@ -0,0 +1,124 @@
+#ifndef ELECTRON_SHELL_COMMON_ASAR_BINARY_HEADER_H_
+#define ELECTRON_SHELL_COMMON_ASAR_BINARY_HEADER_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <nlohmann/json.hpp>
+
+namespace asar {
+
+// A binary alternative to the JSON archive header, used straight from a
+// mapping of the archive without parsing or allocating.
+//
+// An archive with a binary header has kPickleMarker instead of 4 as the
+// payload size of its size pickle, followed as usual by the size of the
+// header, the header and the payloads. The header is a table, all numbers
+// little endian, padded with zeros up to the header size:
+//
+//   Prefix
+//   Record[entry_count]       breadth-first, the root first, the children of
+//                             a directory contiguous and sorted by name
+//   uint32[entry_count]       the records sorted by path, padded to 8 bytes
+//   uint8[32][digest_count]   SHA256 digests
+//   char[strings_size]        paths and link targets, padded to 8 bytes
+class BinaryHeader {
+ public:
+  // Payload size of the size pickle flagging a binary header, "\4\0V2".
+  static constexpr uint32_t kPickleMarker = 0x32560004;
+  static constexpr uint32_t kVersion = 2;
+  static constexpr uint32_t kNotFound = UINT32_MAX;
+  static constexpr size_t kDigestSize = 32;
+
+  // Same values as Archive::FileType.
+  enum Type : uint8_t {
+    kFile = 1,
+    kDirectory = 2,
+    kLink = 3,
+  };
+
+  enum Flags : uint8_t {
+    kExecutable = 1 << 0,
+    kUnpacked = 1 << 1,
+    kIntegrity = 1 << 2,
+  };
+
+  struct Prefix {
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t digest_count;
+    uint32_t reserved;
+    uint64_t strings_size;
+    // Size of the table, without the padding up to the header size.
+    uint64_t table_size;
+  };
+
+  struct Record {
+    // Files: offset of the payload from the end of the header, and size.
+    // Links: offset and size of the target in the strings.
+    uint64_t offset;
+    uint64_t size;
+    // The path from the root in the strings, "/" separated, the name is
+    // its last |name_size| bytes.
+    uint32_t path_offset;
+    uint32_t path_size;
+    uint32_t name_size;
+    // Directories: the records of the children.
+    uint32_t first_child;
+    uint32_t child_count;
+    // Files with kIntegrity: the digest of the file, followed by the
+    // digests of its |block_count| blocks.
+    uint32_t digest;
+    uint32_t block_count;
+    uint32_t block_size;
+    uint8_t type;
+    uint8_t flags;
+    uint8_t reserved[6];
+  };
+
+  BinaryHeader();
+  ~BinaryHeader();
+
+  // Encodes the JSON header |root| into |table|. Keys that are not part of
+  // the asar format are dropped.
+  static bool Encode(const nlohmann::json& root, std::string* table, std::string* error);
+
+  // Uses the table at |data|, which must be 8-byte aligned and outlive this
+  // object. All offsets and ranges are checked here, once.
+  bool Init(const char* data, uint64_t size);
+  void Reset();
+  bool valid() const { return prefix_ != nullptr; }
+
+  uint32_t entry_count() const { return prefix_->entry_count; }
+  uint64_t table_size() const { return prefix_->table_size; }
+  const Record& record(uint32_t index) const { return records_[index]; }
+  std::string_view path(uint32_t index) const;
+  std::string_view name(uint32_t index) const;
+  std::string_view link(uint32_t index) const;
+  std::string DigestHex(uint32_t digest) const;
+
+  // The record at the "/" separated |path|, a binary search of the path
+  // table. Links are not followed.
+  uint32_t FindPath(std::string_view path) const;
+
+  // The child |name| of the directory at |index|, a binary search of its
+  // children.
+  uint32_t FindChild(uint32_t index, std::string_view name) const;
+
+  // Decodes the table into the JSON header format.
+  nlohmann::json ToJson() const;
+
+ private:
+  nlohmann::json RecordToJson(uint32_t index) const;
+
+  const Prefix* prefix_ = nullptr;
+  const Record* records_ = nullptr;
+  const uint32_t* sorted_ = nullptr;
+  const uint8_t* digests_ = nullptr;
+  const char* strings_ = nullptr;
+};
+
+}  // namespace asar
+
+#endif  // ELECTRON_SHELL_COMMON_ASAR_BINARY_HEADER_H_
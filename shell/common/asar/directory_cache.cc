@@ -0,0 +1,228 @@
+#include "directory_cache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <limits.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "./logger.h"
+
+namespace asar {
+
+namespace {
+
+constexpr size_t kDefaultMaxEntries = 8192;
+// Keep clear of the default fs.inotify.max_user_watches.
+constexpr size_t kMaxWatches = 1024;
+
+}  // namespace
+
+DirectoryCache& DirectoryCache::GetInstance() {
+  static DirectoryCache* cache = new DirectoryCache();
+  return *cache;
+}
+
+DirectoryCache::DirectoryCache()
+    : max_entries_per_shard_(kDefaultMaxEntries / kShardCount) {}
+
+DirectoryCache::~DirectoryCache() = default;
+
+void DirectoryCache::Configure(size_t max_entries,
+                               std::chrono::milliseconds ttl,
+                               bool watch) {
+  max_entries_per_shard_ = std::max<size_t>(1, max_entries / kShardCount);
+  ttl_ms_ = ttl.count();
+  watch_enabled_ = watch;
+  Clear();
+}
+
+DirectoryCache::Shard& DirectoryCache::GetShard(const std::string& path) {
+  return shards_[std::hash<std::string>()(path) % kShardCount];
+}
+
+std::unique_lock<std::mutex> DirectoryCache::LockShard(Shard& shard) {
+  std::unique_lock<std::mutex> lock(shard.mutex, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    contentions_.fetch_add(1, std::memory_order_relaxed);
+    lock.lock();
+  }
+  return lock;
+}
+
+bool DirectoryCache::IsDirectory(const std::filesystem::path& path) {
+  const std::string key = path.string();
+  Shard& shard = GetShard(key);
+  const auto now = std::chrono::steady_clock::now();
+
+  uint64_t generation = 0U;
+  {
+    std::unique_lock<std::mutex> lock = LockShard(shard);
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+      if (now < it->second.expires) {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lru);
+        return it->second.is_directory;
+      }
+      shard.lru.erase(it->second.lru);
+      shard.entries.erase(it);
+      invalidations_.fetch_add(1, std::memory_order_relaxed);
+    }
+    generation = shard.generation;
+  }
+
+  // Watch before probing, probe without holding the shard. A change after
+  // the probe bumps the generation, and the result is then not cached.
+  const bool watched = watch_enabled_ && Watch(path);
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  std::error_code ec;
+  const bool is_directory = std::filesystem::is_directory(path, ec) && !ec;
+
+  auto ttl = std::chrono::milliseconds(ttl_ms_.load());
+  if (watch_enabled_ && !watched) {
+    unwatched_.fetch_add(1, std::memory_order_relaxed);
+    if (ttl.count() == 0)
+      ttl = kUnwatchedTtl;
+  }
+  const auto expires = ttl.count() == 0 ? std::chrono::steady_clock::time_point::max() : now + ttl;
+
+  std::unique_lock<std::mutex> lock = LockShard(shard);
+  if (shard.generation != generation)
+    return is_directory;
+  auto it = shard.entries.find(key);
+  if (it != shard.entries.end()) {
+    it->second.is_directory = is_directory;
+    it->second.expires = expires;
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lru);
+    return is_directory;
+  }
+  if (shard.entries.size() >= max_entries_per_shard_) {
+    shard.entries.erase(shard.lru.back());
+    shard.lru.pop_back();
+    evictions_.fetch_add(1, std::memory_order_relaxed);
+  }
+  shard.lru.push_front(key);
+  shard.entries[key] = {is_directory, expires, shard.lru.begin()};
+  return is_directory;
+}
+
+void DirectoryCache::Invalidate(const std::string& path) {
+  Shard& shard = GetShard(path);
+  std::unique_lock<std::mutex> lock = LockShard(shard);
+  ++shard.generation;
+  auto it = shard.entries.find(path);
+  if (it == shard.entries.end())
+    return;
+  shard.lru.erase(it->second.lru);
+  shard.entries.erase(it);
+  invalidations_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DirectoryCache::Clear() {
+  for (Shard& shard : shards_) {
+    std::unique_lock<std::mutex> lock = LockShard(shard);
+    ++shard.generation;
+    invalidations_.fetch_add(shard.entries.size(), std::memory_order_relaxed);
+    shard.entries.clear();
+    shard.lru.clear();
+  }
+}
+
+DirectoryCache::Counters DirectoryCache::GetCounters() const {
+  Counters counters;
+  counters.hits = hits_;
+  counters.misses = misses_;
+  counters.evictions = evictions_;
+  counters.invalidations = invalidations_;
+  counters.contentions = contentions_;
+  counters.unwatched = unwatched_;
+  for (const Shard& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    counters.entries += shard.entries.size();
+  }
+  return counters;
+}
+
+bool DirectoryCache::Watch(const std::filesystem::path& path) {
+#if defined(__linux__)
+  const std::string dir = path.parent_path().string();
+  std::lock_guard<std::mutex> lock(watch_lock_);
+  if (watched_dirs_.count(dir))
+    return true;
+  if (watch_unavailable_ || watched_dirs_.size() >= kMaxWatches)
+    return false;
+
+  if (watch_fd_ < 0) {
+    watch_fd_ = inotify_init1(IN_CLOEXEC);
+    if (watch_fd_ < 0) {
+      LOG_WARNING("inotify is not available, directory cache relies on TTL");
+      watch_unavailable_ = true;
+      return false;
+    }
+    std::thread(&DirectoryCache::RunWatcher, this).detach();
+  }
+
+  const int wd = inotify_add_watch(watch_fd_, dir.c_str(),
+                                   IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                   IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+  if (wd < 0)
+    return false;
+  watches_[wd] = dir;
+  watched_dirs_[dir] = wd;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void DirectoryCache::RunWatcher() {
+#if defined(__linux__)
+  std::vector<char> buf(64 * (sizeof(struct inotify_event) + NAME_MAX + 1));
+  while (true) {
+    const ssize_t length = read(watch_fd_, buf.data(), buf.size());
+    if (length <= 0) {
+      if (length < 0 && errno == EINTR)
+        continue;
+      return;
+    }
+
+    for (ssize_t offset = 0; offset < length;) {
+      const auto* event = reinterpret_cast<const struct inotify_event*>(buf.data() + offset);
+      offset += sizeof(struct inotify_event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        Clear();
+        continue;
+      }
+
+      std::string dir;
+      {
+        std::lock_guard<std::mutex> lock(watch_lock_);
+        auto it = watches_.find(event->wd);
+        if (it == watches_.end())
+          continue;
+        dir = it->second;
+        if (event->mask & IN_IGNORED) {
+          watched_dirs_.erase(dir);
+          watches_.erase(it);
+        }
+      }
+
+      if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+        // Paths below a moved directory may now resolve elsewhere.
+        Clear();
+      } else if (event->len > 0) {
+        Invalidate((std::filesystem::path(dir) / event->name).string());
+      }
+    }
+  }
+#endif
+}
+
+}  // namespace asar
@@ -0,0 +1,107 @@
+#ifndef ELECTRON_SHELL_COMMON_ASAR_DIRECTORY_CACHE_H_
+#define ELECTRON_SHELL_COMMON_ASAR_DIRECTORY_CACHE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace asar {
+
+// Caches whether paths are directories, used to tell "*.asar" directories
+// from archives when a path is not inside a registered archive.
+//
+// Entries are spread over independently locked shards, the total count is
+// capped by evicting the least recently used entries, and entries are
+// invalidated either after a TTL or, on Linux, by inotify events on their
+// parent directories. Paths whose parent cannot be watched expire after the
+// TTL, or kUnwatchedTtl without one.
+class DirectoryCache {
+ public:
+  struct Counters {
+    uint64_t hits = 0U;
+    uint64_t misses = 0U;
+    uint64_t evictions = 0U;
+    uint64_t invalidations = 0U;
+    // Lookups that had to wait for another thread holding their shard.
+    uint64_t contentions = 0U;
+    // Lookups cached with a TTL as their parent could not be watched.
+    uint64_t unwatched = 0U;
+    uint64_t entries = 0U;
+  };
+
+  static DirectoryCache& GetInstance();
+
+  // |ttl| of 0 keeps entries until invalidated, |watch| enables inotify
+  // based invalidation where it is supported.
+  void Configure(size_t max_entries, std::chrono::milliseconds ttl, bool watch);
+
+  bool IsDirectory(const std::filesystem::path& path);
+
+  // Forgets |path|, or everything.
+  void Invalidate(const std::string& path);
+  void Clear();
+
+  Counters GetCounters() const;
+
+ private:
+  static constexpr size_t kShardCount = 16;
+  static constexpr std::chrono::milliseconds kUnwatchedTtl{1000};
+
+  struct Entry {
+    bool is_directory = false;
+    // time_point::max() for entries kept until invalidated.
+    std::chrono::steady_clock::time_point expires;
+    std::list<std::string>::iterator lru;
+  };
+
+  struct Shard {
+    // Also taken by the const GetCounters.
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    // Keys, the most recently used first.
+    std::list<std::string> lru;
+    // Bumped by every invalidation, so that a probe racing with one is not
+    // cached.
+    uint64_t generation = 0U;
+  };
+
+  DirectoryCache();
+  ~DirectoryCache();
+
+  Shard& GetShard(const std::string& path);
+  std::unique_lock<std::mutex> LockShard(Shard& shard);
+
+  // Starts watching the parent directory of |path| for changes. Returns
+  // whether it is watched.
+  bool Watch(const std::filesystem::path& path);
+  void RunWatcher();
+
+  Shard shards_[kShardCount];
+
+  std::atomic<size_t> max_entries_per_shard_;
+  std::atomic<int64_t> ttl_ms_{0};
+  std::atomic<bool> watch_enabled_{true};
+
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> evictions_{0};
+  std::atomic<uint64_t> invalidations_{0};
+  std::atomic<uint64_t> contentions_{0};
+  std::atomic<uint64_t> unwatched_{0};
+
+  std::mutex watch_lock_;
+  int watch_fd_ = -1;
+  bool watch_unavailable_ = false;
+  // Watched directories by watch descriptor.
+  std::unordered_map<int, std::string> watches_;
+  std::unordered_map<std::string, int> watched_dirs_;
+};
+
+}  // namespace asar
+
+#endif  // ELECTRON_SHELL_COMMON_ASAR_DIRECTORY_CACHE_H_
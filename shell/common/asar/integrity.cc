@@ -0,0 +1,243 @@
+#include "integrity.h"
+
+#include <algorithm>
+#include <chrono>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+
+#include "./archive.h"
+#include "./asar_util.h"
+#include "./logger.h"
+
+namespace asar {
+
+namespace {
+
+std::string ToHex(const unsigned char* hash, size_t size) {
+  static const char kHexChars[] = "0123456789abcdef";
+  std::string hex(size * 2, '0');
+  for (size_t i = 0; i < size; ++i) {
+    hex[i * 2] = kHexChars[hash[i] >> 4];
+    hex[i * 2 + 1] = kHexChars[hash[i] & 0xf];
+  }
+  return hex;
+}
+
+std::string_view GetBlock(std::string_view input, uint32_t block_size, size_t index) {
+  return input.substr(index * block_size, block_size);
+}
+
+bool ValidateBlock(std::string_view block,
+                   const IntegrityPayload& integrity,
+                   size_t index) {
+  const std::string hex_hash = Sha256Hex(block);
+  if (integrity.blocks[index] != hex_hash) {
+    LOG_ERROR("Integrity check failed for asar archive block " + std::to_string(index) +
+              " (" + integrity.blocks[index] + " vs " + hex_hash + ")");
+    return false;
+  }
+  return true;
+}
+
+// Smallest content hashed on more than one thread.
+constexpr uint64_t kParallelHashMinSize = 8 * 1024 * 1024;
+
+}  // namespace
+
+unsigned HashConcurrency(uint64_t size) {
+  return size < kParallelHashMinSize ? 1U : 0U;
+}
+
+std::string Sha256Hex(std::string_view data) {
+  unsigned char hash[SHA256_DIGEST_LENGTH];
+  SHA256(reinterpret_cast<const unsigned char*>(data.data()), data.size(), hash);
+  return ToHex(hash, SHA256_DIGEST_LENGTH);
+}
+
+Sha256::Sha256() : context_(EVP_MD_CTX_new()) {
+  EVP_DigestInit_ex(static_cast<EVP_MD_CTX*>(context_), EVP_sha256(), nullptr);
+}
+
+Sha256::~Sha256() {
+  EVP_MD_CTX_free(static_cast<EVP_MD_CTX*>(context_));
+}
+
+void Sha256::Update(std::string_view data) {
+  EVP_DigestUpdate(static_cast<EVP_MD_CTX*>(context_), data.data(), data.size());
+}
+
+std::string Sha256::FinishHex() {
+  unsigned char hash[EVP_MAX_MD_SIZE];
+  unsigned int size = 0;
+  EVP_DigestFinal_ex(static_cast<EVP_MD_CTX*>(context_), hash, &size);
+  return ToHex(hash, size);
+}
+
+bool HasIntegrityBlocks(const IntegrityPayload& integrity, uint64_t size) {
+  if (integrity.algorithm != HashAlgorithm::kSHA256 ||
+      integrity.block_size == 0 || size == 0)
+    return false;
+  return integrity.blocks.size() ==
+         (size + integrity.block_size - 1) / integrity.block_size;
+}
+
+bool ValidateIntegrityBlocks(std::string_view input,
+                             const IntegrityPayload& integrity,
+                             size_t first_block,
+                             unsigned concurrency) {
+  const uint32_t block_size = integrity.block_size;
+  const size_t count = (input.size() + block_size - 1) / block_size;
+  if (first_block + count > integrity.blocks.size()) {
+    LOG_ERROR("Integrity blocks out of range in asar archive");
+    return false;
+  }
+
+  return ParallelFor(count, concurrency, [&](size_t index) {
+    return ValidateBlock(GetBlock(input, block_size, index), integrity,
+                         first_block + index);
+  });
+}
+
+bool ValidateFileIntegrity(std::string_view input,
+                           const IntegrityPayload& integrity,
+                           unsigned concurrency) {
+  if (HasIntegrityBlocks(integrity, input.size()))
+    return ValidateIntegrityBlocks(input, integrity, 0, concurrency);
+  return ValidateIntegrity(input, integrity);
+}
+
+BlockVerifier::BlockVerifier(const IntegrityPayload& integrity,
+                             const char* data,
+                             uint64_t size,
+                             unsigned concurrency)
+    : integrity_(integrity),
+      data_(data),
+      size_(size),
+      block_count_(integrity.blocks.size()) {
+  if (concurrency == 0)
+    concurrency = std::max(1U, std::thread::hardware_concurrency());
+  concurrency = static_cast<unsigned>(std::min<size_t>(concurrency, block_count_));
+  for (unsigned i = 0; i < concurrency; ++i)
+    workers_.emplace_back(&BlockVerifier::Run, this);
+}
+
+BlockVerifier::~BlockVerifier() {
+  Finish();
+}
+
+void BlockVerifier::Feed(uint64_t end) {
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    ready_blocks_ = end >= size_ ? block_count_ : end / integrity_.block_size;
+  }
+  ready_.notify_all();
+}
+
+bool BlockVerifier::Finish() {
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    finished_ = true;
+  }
+  ready_.notify_all();
+  for (auto& worker : workers_)
+    worker.join();
+  workers_.clear();
+
+  std::lock_guard<std::mutex> lock(lock_);
+  return !failed_ && ready_blocks_ == block_count_ && next_block_ == block_count_;
+}
+
+void BlockVerifier::Run() {
+  const std::string_view input(data_, size_);
+  std::unique_lock<std::mutex> lock(lock_);
+  while (true) {
+    ready_.wait(lock, [this]() {
+      return failed_ || finished_ || next_block_ < ready_blocks_;
+    });
+    if (failed_ || next_block_ >= ready_blocks_)
+      return;
+
+    const size_t index = next_block_++;
+    lock.unlock();
+    const auto start = std::chrono::steady_clock::now();
+    const bool ok = ValidateBlock(GetBlock(input, integrity_.block_size, index),
+                                  integrity_, index);
+    hash_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    lock.lock();
+    if (!ok) {
+      failed_ = true;
+      ready_.notify_all();
+    }
+  }
+}
+
+VerifiedSet::VerifiedSet() = default;
+VerifiedSet::~VerifiedSet() = default;
+
+void VerifiedSet::Reset(std::vector<Payload> payloads) {
+  payloads.erase(std::remove_if(payloads.begin(), payloads.end(),
+                                [](const Payload& payload) { return payload.second == 0; }),
+                 payloads.end());
+  std::sort(payloads.begin(), payloads.end());
+  payloads.erase(std::unique(payloads.begin(), payloads.end()), payloads.end());
+  payloads_ = std::move(payloads);
+  bits_ = std::make_unique<std::atomic<uint64_t>[]>((payloads_.size() + 63) / 64);
+  hash_ns_ = std::make_unique<std::atomic<uint32_t>[]>(payloads_.size());
+  Clear();
+}
+
+void VerifiedSet::Clear() {
+  for (size_t i = 0; i < (payloads_.size() + 63) / 64; ++i)
+    bits_[i] = 0;
+  verified_files_ = 0;
+}
+
+ptrdiff_t VerifiedSet::IndexOf(uint64_t offset, uint64_t size) const {
+  const Payload payload(offset, size);
+  auto it = std::lower_bound(payloads_.begin(), payloads_.end(), payload);
+  if (it == payloads_.end() || *it != payload)
+    return -1;
+  return it - payloads_.begin();
+}
+
+bool VerifiedSet::Contains(uint64_t offset, uint64_t size) {
+  const ptrdiff_t index = IndexOf(offset, size);
+  if (index < 0)
+    return false;
+  const uint64_t mask = uint64_t{1} << (index % 64);
+  if (!(bits_[index / 64].load(std::memory_order_acquire) & mask))
+    return false;
+
+  skipped_reads_.fetch_add(1, std::memory_order_relaxed);
+  skipped_bytes_.fetch_add(size, std::memory_order_relaxed);
+  saved_ns_.fetch_add(hash_ns_[index].load(std::memory_order_relaxed), std::memory_order_relaxed);
+  return true;
+}
+
+void VerifiedSet::Add(uint64_t offset, uint64_t size, uint64_t hash_ns) {
+  hashed_bytes_.fetch_add(size, std::memory_order_relaxed);
+  total_hash_ns_.fetch_add(hash_ns, std::memory_order_relaxed);
+
+  const ptrdiff_t index = IndexOf(offset, size);
+  if (index < 0)
+    return;
+  hash_ns_[index].store(static_cast<uint32_t>(std::min<uint64_t>(hash_ns, UINT32_MAX)),
+                        std::memory_order_relaxed);
+  const uint64_t mask = uint64_t{1} << (index % 64);
+  if (!(bits_[index / 64].fetch_or(mask, std::memory_order_release) & mask))
+    verified_files_.fetch_add(1, std::memory_order_relaxed);
+}
+
+VerifiedSet::Counters VerifiedSet::GetCounters() const {
+  Counters counters;
+  counters.verified_files = verified_files_;
+  counters.hashed_bytes = hashed_bytes_;
+  counters.hash_ns = total_hash_ns_;
+  counters.skipped_reads = skipped_reads_;
+  counters.skipped_bytes = skipped_bytes_;
+  counters.saved_ns = saved_ns_;
+  return counters;
+}
+
+}  // namespace asar
@@ -0,0 +1,162 @@
+#ifndef ELECTRON_SHELL_COMMON_ASAR_INTEGRITY_H_
+#define ELECTRON_SHELL_COMMON_ASAR_INTEGRITY_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace asar {
+
+struct IntegrityPayload;
+
+// Returns the lower case hex SHA256 digest of |data|.
+std::string Sha256Hex(std::string_view data);
+
+// Computes a SHA256 digest incrementally, for data that is not in memory at
+// once.
+class Sha256 {
+ public:
+  Sha256();
+  ~Sha256();
+
+  // disable copy
+  Sha256(const Sha256&) = delete;
+  Sha256& operator=(const Sha256&) = delete;
+
+  void Update(std::string_view data);
+
+  // Returns the lower case hex digest of everything fed so far.
+  std::string FinishHex();
+
+ private:
+  void* context_;
+};
+
+// Whether |integrity| carries one block hash for every |block_size| bytes of
+// a file with |size| bytes, so the file can be validated block by block.
+bool HasIntegrityBlocks(const IntegrityPayload& integrity, uint64_t size);
+
+// Threads worth hashing |size| bytes on: 1 below a few MiB, which take
+// milliseconds on one core, about what starting a thread per core costs,
+// otherwise 0 for one per core.
+unsigned HashConcurrency(uint64_t size);
+
+// Validates |input| starting at block |first_block| against the block hashes
+// of |integrity|, |input| must end at a block boundary or at the end of file.
+bool ValidateIntegrityBlocks(std::string_view input,
+                             const IntegrityPayload& integrity,
+                             size_t first_block,
+                             unsigned concurrency);
+
+// Validates the whole content of a file, block by block on up to
+// |concurrency| threads when block hashes are available.
+bool ValidateFileIntegrity(std::string_view input,
+                           const IntegrityPayload& integrity,
+                           unsigned concurrency);
+
+// Validates the blocks of a file while it is still being read: blocks are
+// hashed on worker threads as soon as Feed() reports them complete.
+class BlockVerifier {
+ public:
+  BlockVerifier(const IntegrityPayload& integrity,
+                const char* data,
+                uint64_t size,
+                unsigned concurrency);
+  ~BlockVerifier();
+
+  // disable copy
+  BlockVerifier(const BlockVerifier&) = delete;
+  BlockVerifier& operator=(const BlockVerifier&) = delete;
+
+  // The first |end| bytes of |data| have been read.
+  void Feed(uint64_t end);
+
+  // Waits for the remaining blocks, returns false if any block mismatched.
+  bool Finish();
+
+  // Time spent hashing blocks, summed over all workers.
+  uint64_t hash_ns() const { return hash_ns_; }
+
+ private:
+  void Run();
+
+  const IntegrityPayload& integrity_;
+  const char* data_;
+  uint64_t size_;
+  size_t block_count_;
+
+  std::mutex lock_;
+  std::condition_variable ready_;
+  size_t ready_blocks_ = 0;
+  size_t next_block_ = 0;
+  bool finished_ = false;
+  bool failed_ = false;
+  std::atomic<uint64_t> hash_ns_{0};
+  std::vector<std::thread> workers_;
+};
+
+// Remembers which packed files of an archive passed integrity validation so
+// hot files are hashed only once. Files are identified by the offset and
+// size of their payload in the archive, files sharing a payload share the
+// verified state. Empty files are never tracked, they share their offset
+// with the next file without sharing its payload.
+class VerifiedSet {
+ public:
+  struct Counters {
+    uint64_t verified_files = 0U;
+    uint64_t hashed_bytes = 0U;
+    uint64_t hash_ns = 0U;
+    uint64_t skipped_reads = 0U;
+    uint64_t skipped_bytes = 0U;
+    uint64_t saved_ns = 0U;
+  };
+
+  VerifiedSet();
+  ~VerifiedSet();
+
+  // Offset and size of a payload.
+  using Payload = std::pair<uint64_t, uint64_t>;
+
+  // Tracks the files at |payloads|, forgetting everything verified before.
+  void Reset(std::vector<Payload> payloads);
+
+  // Forgets everything verified so far.
+  void Clear();
+
+  // Whether the file of |size| bytes at |offset| has been verified, counts a
+  // skipped hash if it has.
+  bool Contains(uint64_t offset, uint64_t size);
+
+  // Records that the file of |size| bytes at |offset| passed validation in
+  // |hash_ns|.
+  void Add(uint64_t offset, uint64_t size, uint64_t hash_ns);
+
+  Counters GetCounters() const;
+
+ private:
+  // Index of the payload in |payloads_|, or -1.
+  ptrdiff_t IndexOf(uint64_t offset, uint64_t size) const;
+
+  std::vector<Payload> payloads_;
+  std::unique_ptr<std::atomic<uint64_t>[]> bits_;
+  // Time it took to validate each file, capped to UINT32_MAX ns.
+  std::unique_ptr<std::atomic<uint32_t>[]> hash_ns_;
+
+  std::atomic<uint64_t> verified_files_{0};
+  std::atomic<uint64_t> hashed_bytes_{0};
+  std::atomic<uint64_t> total_hash_ns_{0};
+  std::atomic<uint64_t> skipped_reads_{0};
+  std::atomic<uint64_t> skipped_bytes_{0};
+  std::atomic<uint64_t> saved_ns_{0};
+};
+
+}  // namespace asar
+
+#endif  // ELECTRON_SHELL_COMMON_ASAR_INTEGRITY_H_
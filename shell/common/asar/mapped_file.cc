@@ -0,0 +1,93 @@
+#include "mapped_file.h"
+
+#if defined(_WIN32)
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace asar {
+
+MappedFile::MappedFile() = default;
+
+#if defined(_WIN32)
+
+MappedFile::~MappedFile() {
+  if (base_)
+    UnmapViewOfFile(base_);
+  if (mapping_)
+    CloseHandle(mapping_);
+}
+
+bool MappedFile::Map(int fd) {
+  HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+  LARGE_INTEGER size;
+  if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    return false;
+  return MapRange(fd, 0, static_cast<uint64_t>(size.QuadPart), false);
+}
+
+bool MappedFile::MapRange(int fd, uint64_t offset, uint64_t size, bool copy_on_write) {
+  HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+  if (file == INVALID_HANDLE_VALUE || size == 0)
+    return false;
+
+  // Views start at a multiple of the allocation granularity.
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  const uint64_t start = offset - offset % info.dwAllocationGranularity;
+  const uint64_t end = offset + size;
+
+  mapping_ = CreateFileMappingW(file, nullptr, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY,
+                                static_cast<DWORD>(end >> 32), static_cast<DWORD>(end), nullptr);
+  if (!mapping_)
+    return false;
+  base_ = MapViewOfFile(mapping_, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ,
+                        static_cast<DWORD>(start >> 32), static_cast<DWORD>(start),
+                        static_cast<SIZE_T>(end - start));
+  if (!base_)
+    return false;
+  mapped_size_ = end - start;
+  data_ = static_cast<const char*>(base_) + (offset - start);
+  size_ = size;
+  return true;
+}
+
+#else
+
+MappedFile::~MappedFile() {
+  if (base_)
+    munmap(base_, mapped_size_);
+}
+
+bool MappedFile::Map(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    return false;
+  return MapRange(fd, 0, static_cast<uint64_t>(st.st_size), false);
+}
+
+bool MappedFile::MapRange(int fd, uint64_t offset, uint64_t size, bool copy_on_write) {
+  if (size == 0)
+    return false;
+
+  static const uint64_t page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  const uint64_t start = offset - offset % page_size;
+  const uint64_t length = offset + size - start;
+  void* base = mmap(nullptr, length, copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ,
+                    copy_on_write ? MAP_PRIVATE : MAP_SHARED, fd, static_cast<off_t>(start));
+  if (base == MAP_FAILED)
+    return false;
+  base_ = base;
+  mapped_size_ = length;
+  data_ = static_cast<const char*>(base) + (offset - start);
+  size_ = size;
+  return true;
+}
+
+#endif
+
+}  // namespace asar
@@ -0,0 +1,45 @@
+#ifndef ELECTRON_SHELL_COMMON_ASAR_MAPPED_FILE_H_
+#define ELECTRON_SHELL_COMMON_ASAR_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace asar {
+
+// A read-only memory mapping of a whole file or of a range of it, unmapped
+// on destruction.
+class MappedFile {
+ public:
+  MappedFile();
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // Maps the file open as |fd|, which may be closed afterwards.
+  bool Map(int fd);
+
+  // Maps |size| bytes at |offset| of the file open as |fd|. The mapping
+  // starts at the page below |offset|, data() points at |offset|. With
+  // |copy_on_write| the pages may be written, writes are private to the
+  // mapping and never reach the file.
+  bool MapRange(int fd, uint64_t offset, uint64_t size, bool copy_on_write);
+
+  const char* data() const { return data_; }
+  char* mutable_data() const { return const_cast<char*>(data_); }
+  uint64_t size() const { return size_; }
+
+ private:
+  const char* data_ = nullptr;
+  uint64_t size_ = 0U;
+  // The whole mapping, from the page below data().
+  void* base_ = nullptr;
+  uint64_t mapped_size_ = 0U;
+#if defined(_WIN32)
+  void* mapping_ = nullptr;
+#endif
+};
+
+}  // namespace asar
+
+#endif  // ELECTRON_SHELL_COMMON_ASAR_MAPPED_FILE_H_
@@ -0,0 +1,160 @@
+#include "mount_table.h"
+
+#include <functional>
+#include <mutex>
+
+namespace asar {
+
+namespace {
+
+#if defined(_WIN32)
+constexpr char kSeparator[] = "\\";
+#else
+constexpr char kSeparator[] = "/";
+#endif
+
+bool IsSeparator(char c) {
+#if defined(_WIN32)
+  return c == '/' || c == '\\';
+#else
+  return c == '/';
+#endif
+}
+
+// Calls |callback| with each non-empty component of |path| and the offset
+// just past it, until |callback| returns false.
+template <typename Callback>
+void ForEachComponent(std::string_view path, Callback callback) {
+  size_t pos = 0;
+  while (pos < path.size()) {
+    while (pos < path.size() && IsSeparator(path[pos]))
+      ++pos;
+    size_t end = pos;
+    while (end < path.size() && !IsSeparator(path[end]))
+      ++end;
+    if (end == pos)
+      return;
+    if (!callback(path.substr(pos, end - pos), end))
+      return;
+    pos = end;
+  }
+}
+
+std::string_view TrimTrailingSeparators(std::string_view path) {
+  while (path.size() > 1 && IsSeparator(path.back()))
+    path.remove_suffix(1);
+  return path;
+}
+
+}  // namespace
+
+MountTable& MountTable::GetInstance() {
+  static MountTable* table = new MountTable();
+  return *table;
+}
+
+MountTable::MountTable() = default;
+
+MountTable::~MountTable() = default;
+
+void MountTable::Add(std::string_view mount_point, std::string_view target) {
+  std::unique_lock<std::shared_mutex> lock(lock_);
+  Node* node = &root_;
+  ForEachComponent(mount_point, [&node](std::string_view name, size_t) {
+    std::unique_ptr<Node>& child = node->children[std::string(name)];
+    if (!child)
+      child = std::make_unique<Node>();
+    node = child.get();
+    return true;
+  });
+  if (!node->target)
+    ++size_;
+  node->target = std::string(TrimTrailingSeparators(target));
+}
+
+bool MountTable::Remove(std::string_view mount_point) {
+  std::unique_lock<std::shared_mutex> lock(lock_);
+  Node* node = &root_;
+  ForEachComponent(mount_point, [&node](std::string_view name, size_t) {
+    auto it = node->children.find(std::string(name));
+    node = it == node->children.end() ? nullptr : it->second.get();
+    return node != nullptr;
+  });
+  if (!node || !node->target)
+    return false;
+  // Empty branches are left in place, mount points are rarely removed.
+  node->target.reset();
+  --size_;
+  return true;
+}
+
+void MountTable::Clear() {
+  std::unique_lock<std::shared_mutex> lock(lock_);
+  root_.children.clear();
+  root_.target.reset();
+  size_ = 0;
+}
+
+std::optional<std::string> MountTable::Resolve(std::string_view path) const {
+  std::shared_lock<std::shared_mutex> lock(lock_);
+  if (size_ == 0)
+    return std::nullopt;
+
+  const Node* node = &root_;
+  const std::string* target = nullptr;
+  size_t matched = 0;
+  std::string key;
+  ForEachComponent(path, [&](std::string_view name, size_t end) {
+    key.assign(name.data(), name.size());
+    auto it = node->children.find(key);
+    if (it == node->children.end())
+      return false;
+    node = it->second.get();
+    if (node->target) {
+      target = &*node->target;
+      matched = end;
+    }
+    return true;
+  });
+  if (!target)
+    return std::nullopt;
+
+  std::string result;
+  result.reserve(target->size() + path.size() - matched);
+  result.append(*target);
+  result.append(path.substr(matched));
+  return result;
+}
+
+std::vector<MountTable::Mount> MountTable::GetMounts() const {
+  std::shared_lock<std::shared_mutex> lock(lock_);
+  std::vector<Mount> mounts;
+  mounts.reserve(size_);
+  std::string prefix;
+  std::function<void(const Node&)> visit = [&](const Node& node) {
+    if (node.target)
+      mounts.push_back({prefix.empty() ? kSeparator : prefix, *node.target});
+    for (const auto& [name, child] : node.children) {
+      const size_t length = prefix.size();
+#if defined(_WIN32)
+      // Drive letters come first: C:\foo rather than \C:\foo.
+      if (!prefix.empty())
+        prefix.append(kSeparator);
+#else
+      prefix.append(kSeparator);
+#endif
+      prefix.append(name);
+      visit(*child);
+      prefix.resize(length);
+    }
+  };
+  visit(root_);
+  return mounts;
+}
+
+bool MountTable::empty() const {
+  std::shared_lock<std::shared_mutex> lock(lock_);
+  return size_ == 0;
+}
+
+}  // namespace asar
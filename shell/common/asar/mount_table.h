@@ -0,0 +1,57 @@
+#ifndef ELECTRON_SHELL_COMMON_ASAR_MOUNT_TABLE_H_
+#define ELECTRON_SHELL_COMMON_ASAR_MOUNT_TABLE_H_
+
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace asar {
+
+// Maps directories to locations inside archives, e.g. "/app" to
+// "/app.asar" or "/plugins/foo" to "/bundle.asar/plugins/foo".
+//
+// Mount points are kept in a trie of path components, so resolving a path
+// is linear in its length no matter how many mounts are registered, and
+// the deepest mount point wins.
+class MountTable {
+ public:
+  struct Mount {
+    std::string mount_point;
+    std::string target;
+  };
+
+  static MountTable& GetInstance();
+
+  // Mounting over an existing mount point replaces its target.
+  void Add(std::string_view mount_point, std::string_view target);
+  bool Remove(std::string_view mount_point);
+  void Clear();
+
+  // Returns |path| with its longest mounted prefix replaced by the target,
+  // or nothing when |path| is not below any mount point.
+  std::optional<std::string> Resolve(std::string_view path) const;
+
+  std::vector<Mount> GetMounts() const;
+  bool empty() const;
+
+ private:
+  struct Node {
+    std::unordered_map<std::string, std::unique_ptr<Node>> children;
+    std::optional<std::string> target;
+  };
+
+  MountTable();
+  ~MountTable();
+
+  mutable std::shared_mutex lock_;
+  Node root_;
+  size_t size_ = 0;
+};
+
+}  // namespace asar
+
+#endif  // ELECTRON_SHELL_COMMON_ASAR_MOUNT_TABLE_H_
@@ -0,0 +1,764 @@
+#include "packer.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <openssl/sha.h>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "nlohmann/json.hpp"
+#include "./archive.h"
+#include "./asar_util.h"
+#include "./binary_header.h"
+#include "./integrity.h"
+
+namespace fs = std::filesystem;
+
+namespace asar {
+
+namespace {
+
+constexpr size_t kNotDuplicate = SIZE_MAX;
+
+// An entry of the packed tree, |children| index the entries below a
+// directory in name order.
+struct Entry {
+  std::string name;
+  fs::path path;
+  Archive::FileType type = Archive::FileType::kFile;
+  uint64_t size = 0U;
+  bool executable = false;
+  std::string link;
+  std::vector<size_t> children;
+
+  // Relative to the end of the header.
+  uint64_t offset = 0U;
+  IntegrityPayload integrity;
+  bool hashed = false;
+  // Starts at a multiple of PackOptions::alignment in the archive.
+  bool aligned = false;
+  // Index of the file with the same content whose payload is shared.
+  size_t duplicate_of = kNotDuplicate;
+};
+
+class ScopedFD {
+ public:
+  explicit ScopedFD(int fd) : fd_(fd) {}
+  ~ScopedFD() { Close(); }
+
+  ScopedFD(const ScopedFD&) = delete;
+  ScopedFD& operator=(const ScopedFD&) = delete;
+
+  int get() const { return fd_; }
+
+  bool Close() {
+    if (fd_ < 0)
+      return true;
+#if defined(_WIN32)
+    const bool ok = _close(fd_) == 0;
+#else
+    const bool ok = close(fd_) == 0;
+#endif
+    fd_ = -1;
+    return ok;
+  }
+
+ private:
+  int fd_;
+};
+
+int OpenForRead(const fs::path& path) {
+#if defined(_WIN32)
+  return _wopen(path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+  return open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+}
+
+int OpenForWrite(const fs::path& path) {
+#if defined(_WIN32)
+  return _wopen(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+  return open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif
+}
+
+int OpenForUpdate(const fs::path& path) {
+#if defined(_WIN32)
+  return _wopen(path.c_str(), _O_WRONLY | _O_BINARY);
+#else
+  return open(path.c_str(), O_WRONLY | O_CLOEXEC);
+#endif
+}
+
+bool Truncate(int fd, uint64_t size) {
+#if defined(_WIN32)
+  return _chsize_s(fd, static_cast<__int64>(size)) == 0;
+#else
+  return ftruncate(fd, static_cast<off_t>(size)) == 0;
+#endif
+}
+
+// Flushes the writes to |fd| to the disk.
+bool Sync(int fd) {
+#if defined(_WIN32)
+  return _commit(fd) == 0;
+#else
+  return fsync(fd) == 0;
+#endif
+}
+
+std::string Describe(const fs::path& path, const std::error_code& ec) {
+  return path.string() + ": " + ec.message();
+}
+
+// Lists the entries of |dir| in name order. Links must point inside
+// |root|, they are stored relative to it.
+bool ListDirectory(const fs::path& dir,
+                   const fs::path& root,
+                   std::vector<Entry>* entries,
+                   std::string* error) {
+  std::error_code ec;
+  for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+    Entry entry;
+    entry.name = it->path().filename().string();
+    entry.path = it->path();
+
+    const fs::file_status status = it->symlink_status(ec);
+    if (ec)
+      break;
+    if (fs::is_symlink(status)) {
+      const fs::path target = fs::canonical(entry.path, ec);
+      if (ec)
+        break;
+      const fs::path relative = target.lexically_relative(root);
+      if (relative.empty() || *relative.begin() == "..") {
+        *error = entry.path.string() + ": links out of the archive";
+        return false;
+      }
+      entry.type = Archive::FileType::kLink;
+      entry.link = relative.generic_string();
+    } else if (fs::is_directory(status)) {
+      entry.type = Archive::FileType::kDirectory;
+    } else if (fs::is_regular_file(status)) {
+      entry.size = it->file_size(ec);
+      if (ec)
+        break;
+      if (entry.size > UINT32_MAX) {
+        *error = entry.path.string() + ": file too large for an archive";
+        return false;
+      }
+#if !defined(_WIN32)
+      entry.executable = (status.permissions() & fs::perms::owner_exec) != fs::perms::none;
+#endif
+    } else {
+      // Sockets, fifos and devices have no content to pack.
+      continue;
+    }
+    entries->push_back(std::move(entry));
+  }
+  if (ec) {
+    *error = Describe(dir, ec);
+    return false;
+  }
+
+  std::sort(entries->begin(), entries->end(), [](const Entry& a, const Entry& b) {
+    return a.name < b.name;
+  });
+  return true;
+}
+
+// Lists the tree below |root| into |entries|, the root first.
+bool WalkTree(const fs::path& root,
+              unsigned concurrency,
+              std::vector<Entry>* entries,
+              std::string* error) {
+  Entry root_entry;
+  root_entry.path = root;
+  root_entry.type = Archive::FileType::kDirectory;
+  entries->push_back(std::move(root_entry));
+
+  std::vector<size_t> level = {0};
+  while (!level.empty()) {
+    std::vector<std::vector<Entry>> listed(level.size());
+    std::vector<std::string> errors(level.size());
+    const bool ok = ParallelFor(level.size(), concurrency, [&](size_t index) {
+      return ListDirectory((*entries)[level[index]].path, root, &listed[index],
+                           &errors[index]);
+    });
+    if (!ok) {
+      *error = *std::find_if(errors.begin(), errors.end(),
+                             [](const std::string& e) { return !e.empty(); });
+      return false;
+    }
+
+    std::vector<size_t> next_level;
+    for (size_t i = 0; i < level.size(); ++i) {
+      for (Entry& child : listed[i]) {
+        const size_t index = entries->size();
+        (*entries)[level[i]].children.push_back(index);
+        if (child.type == Archive::FileType::kDirectory)
+          next_level.push_back(index);
+        entries->push_back(std::move(child));
+      }
+    }
+    level = std::move(next_level);
+  }
+  return true;
+}
+
+// Collects the files below |index| in the order of their payloads.
+void CollectFiles(const std::vector<Entry>& entries,
+                  size_t index,
+                  std::vector<size_t>* files) {
+  for (size_t child : entries[index].children) {
+    if (entries[child].type == Archive::FileType::kFile)
+      files->push_back(child);
+    else if (entries[child].type == Archive::FileType::kDirectory)
+      CollectFiles(entries, child, files);
+  }
+}
+
+nlohmann::json BuildNode(const std::vector<Entry>& entries, size_t index) {
+  const Entry& entry = entries[index];
+  nlohmann::json node = nlohmann::json::object();
+  switch (entry.type) {
+    case Archive::FileType::kDirectory: {
+      nlohmann::json& files = node["files"] = nlohmann::json::object();
+      for (size_t child : entry.children)
+        files[entries[child].name] = BuildNode(entries, child);
+      break;
+    }
+    case Archive::FileType::kLink:
+      node["link"] = entry.link;
+      break;
+    case Archive::FileType::kFile:
+      node["size"] = entry.size;
+      node["offset"] = std::to_string(entry.offset);
+      if (entry.executable)
+        node["executable"] = true;
+      node["integrity"] = {
+          {"algorithm", "SHA256"},
+          {"hash", entry.integrity.hash},
+          {"blockSize", entry.integrity.block_size},
+          {"blocks", entry.integrity.blocks},
+      };
+      break;
+  }
+  return node;
+}
+
+void AppendUInt32(std::string* out, uint32_t value) {
+  char bytes[sizeof(value)];
+  std::memcpy(bytes, &value, sizeof(value));
+  out->append(bytes, sizeof(value));
+}
+
+// Serializes |root| the way Archive::Init reads it: a size pickle holding
+// the size of the header pickle, then the header pickle holding the JSON
+// string. A binary header replaces the header pickle, see BinaryHeader.
+// The header is padded so that it takes at least |min_size| bytes, a
+// multiple of 4.
+bool SerializeHeader(const nlohmann::json& root,
+                     HeaderFormat format,
+                     uint64_t min_size,
+                     std::string* header,
+                     std::string* error) {
+  header->clear();
+  if (format == HeaderFormat::kBinary) {
+    std::string table;
+    if (!BinaryHeader::Encode(root, &table, error))
+      return false;
+    const size_t size = 2 * sizeof(uint32_t) + table.size();
+    const size_t padding = min_size > size ? min_size - size : 0U;
+    if (table.size() + padding > UINT32_MAX) {
+      *error = "header too large";
+      return false;
+    }
+    header->reserve(size + padding);
+    AppendUInt32(header, BinaryHeader::kPickleMarker);
+    AppendUInt32(header, static_cast<uint32_t>(table.size() + padding));
+    header->append(table);
+    header->append(padding, '\0');
+    return true;
+  }
+
+  const std::string json = root.dump();
+  size_t padding = (4 - json.size() % 4) % 4;
+  const size_t size = 4 * sizeof(uint32_t) + json.size() + padding;
+  if (min_size > size)
+    padding += min_size - size;
+  if (sizeof(uint32_t) + json.size() + padding > UINT32_MAX - sizeof(uint32_t)) {
+    *error = "header too large";
+    return false;
+  }
+  const uint32_t payload_size = static_cast<uint32_t>(sizeof(uint32_t) + json.size() + padding);
+
+  header->reserve(4 * sizeof(uint32_t) + json.size() + padding);
+  AppendUInt32(header, sizeof(uint32_t));
+  AppendUInt32(header, sizeof(uint32_t) + payload_size);
+  AppendUInt32(header, payload_size);
+  AppendUInt32(header, static_cast<uint32_t>(json.size()));
+  header->append(json);
+  header->append(padding, '\0');
+  return true;
+}
+
+bool BuildHeader(const std::vector<Entry>& entries,
+                 HeaderFormat format,
+                 uint64_t min_size,
+                 std::string* header,
+                 std::string* error) {
+  return SerializeHeader(BuildNode(entries, 0), format, min_size, header, error);
+}
+
+// Copies |entry| into the archive at |payload_offset| + its offset while
+// computing its integrity. Only computes the integrity without |out_fd|,
+// only copies with |hash| false.
+bool PackFile(Entry* entry,
+              int out_fd,
+              uint64_t payload_offset,
+              bool hash,
+              std::string* error) {
+  ScopedFD fd(OpenForRead(entry->path));
+  if (fd.get() < 0) {
+    *error = entry->path.string() + ": failed to open";
+    return false;
+  }
+
+  const uint32_t block_size = entry->integrity.block_size;
+  std::string buffer(std::min<uint64_t>(entry->size, block_size), '\0');
+  Sha256 file_hash;
+  for (size_t block = 0; block < entry->integrity.blocks.size(); ++block) {
+    const uint64_t position = block * static_cast<uint64_t>(block_size);
+    const size_t size = static_cast<size_t>(std::min<uint64_t>(entry->size - position, block_size));
+    if (!ReadFromFD(fd.get(), position, buffer.data(), size)) {
+      *error = entry->path.string() + ": failed to read, changed while packing?";
+      return false;
+    }
+    const std::string_view data(buffer.data(), size);
+    if (hash) {
+      entry->integrity.blocks[block] = Sha256Hex(data);
+      file_hash.Update(data);
+    }
+    if (out_fd >= 0 &&
+        !WriteToFD(out_fd, payload_offset + entry->offset + position, data.data(), data.size())) {
+      *error = "failed to write " + entry->path.string() + " into the archive";
+      return false;
+    }
+  }
+  if (hash) {
+    entry->integrity.hash = file_hash.FinishHex();
+    entry->hashed = true;
+  }
+  return true;
+}
+
+// Runs PackFile for |files| on all cores, large files first so that no
+// thread is left with one at the end.
+bool PackFiles(std::vector<Entry>* entries,
+               const std::vector<size_t>& files,
+               int out_fd,
+               uint64_t payload_offset,
+               unsigned concurrency,
+               std::string* error) {
+  std::vector<size_t> order(files);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return (*entries)[a].size > (*entries)[b].size;
+  });
+  std::vector<std::string> errors(order.size());
+  const bool ok = ParallelFor(order.size(), concurrency, [&](size_t index) {
+    Entry* entry = &(*entries)[order[index]];
+    return PackFile(entry, out_fd, payload_offset, !entry->hashed, &errors[index]);
+  });
+  if (!ok) {
+    *error = *std::find_if(errors.begin(), errors.end(),
+                           [](const std::string& e) { return !e.empty(); });
+  }
+  return ok;
+}
+
+bool ShouldAlign(const Entry& entry, const PackOptions& options) {
+  if (options.align_min_size > 0 && entry.size >= options.align_min_size)
+    return true;
+  const std::string extension = entry.path.extension().string();
+  return std::find(options.align_extensions.begin(), options.align_extensions.end(),
+                   extension) != options.align_extensions.end();
+}
+
+// Lays out the payloads of |files| back to back, starting the aligned ones
+// at a multiple of |alignment| in the archive file. Returns the payload
+// size.
+uint64_t AssignOffsets(std::vector<Entry>* entries,
+                       const std::vector<size_t>& files,
+                       uint64_t header_size,
+                       uint64_t alignment) {
+  uint64_t payload_size = 0U;
+  for (size_t index : files) {
+    Entry& entry = (*entries)[index];
+    if (entry.aligned) {
+      const uint64_t position = header_size + payload_size;
+      payload_size += (alignment - position % alignment) % alignment;
+    }
+    entry.offset = payload_size;
+    payload_size += entry.size;
+  }
+  return payload_size;
+}
+
+// Hashes the files that have the same size as another file and points
+// those with the same content at the first of them. Returns the files
+// that still need a payload.
+bool Deduplicate(std::vector<Entry>* entries,
+                 const std::vector<size_t>& files,
+                 unsigned concurrency,
+                 std::vector<size_t>* stored,
+                 std::string* error) {
+  std::unordered_map<uint64_t, size_t> size_counts;
+  for (size_t index : files)
+    ++size_counts[(*entries)[index].size];
+  std::vector<size_t> candidates;
+  for (size_t index : files) {
+    const Entry& entry = (*entries)[index];
+    if (entry.size > 0 && size_counts[entry.size] > 1)
+      candidates.push_back(index);
+  }
+  if (!PackFiles(entries, candidates, -1, 0, concurrency, error))
+    return false;
+
+  std::unordered_map<std::string, size_t> owners;
+  for (size_t index : files) {
+    Entry& entry = (*entries)[index];
+    if (entry.hashed) {
+      auto [it, inserted] = owners.emplace(entry.integrity.hash, index);
+      if (!inserted && (*entries)[it->second].size == entry.size) {
+        entry.duplicate_of = it->second;
+        (*entries)[it->second].aligned |= entry.aligned;
+        continue;
+      }
+    }
+    stored->push_back(index);
+  }
+  return true;
+}
+
+bool WriteArchive(std::vector<Entry>* entries,
+                  const std::vector<size_t>& files,
+                  const fs::path& dest,
+                  const PackOptions& options,
+                  PackStats* stats,
+                  std::string* error) {
+  // Hashes are placeholders of the same length until the files are read.
+  const std::string placeholder(SHA256_DIGEST_LENGTH * 2, '0');
+  for (size_t index : files) {
+    Entry& entry = (*entries)[index];
+    entry.integrity.algorithm = HashAlgorithm::kSHA256;
+    entry.integrity.hash = placeholder;
+    entry.integrity.block_size = options.block_size;
+    // Empty files have the hash of no data as their only block.
+    entry.integrity.blocks.assign(
+        std::max<uint64_t>(1, (entry.size + options.block_size - 1) / options.block_size),
+        placeholder);
+  }
+
+  for (size_t index : files) {
+    Entry& entry = (*entries)[index];
+    entry.aligned = options.alignment > 0 && entry.size > 0 && ShouldAlign(entry, options);
+  }
+
+  std::vector<size_t> stored;
+  if (options.deduplicate) {
+    if (!Deduplicate(entries, files, options.concurrency, &stored, error))
+      return false;
+  } else {
+    stored = files;
+  }
+
+  // Aligned offsets depend on the header size, which depends on the length
+  // of the offsets. Grow the header until the offsets fit, the header is
+  // padded to the size they were aligned for.
+  std::string header;
+  if (!BuildHeader(*entries, options.header_format, 0U, &header, error))
+    return false;
+  uint64_t header_size = header.size();
+  uint64_t payload_size = 0U;
+  while (true) {
+    payload_size = AssignOffsets(entries, stored, header_size, options.alignment);
+    for (size_t index : files) {
+      Entry& entry = (*entries)[index];
+      if (entry.duplicate_of != kNotDuplicate)
+        entry.offset = (*entries)[entry.duplicate_of].offset;
+    }
+    if (!BuildHeader(*entries, options.header_format, 0U, &header, error))
+      return false;
+    if (header.size() <= header_size)
+      break;
+    header_size = header.size();
+  }
+
+  for (size_t index : files) {
+    Entry& entry = (*entries)[index];
+    if (entry.duplicate_of != kNotDuplicate) {
+      entry.integrity = (*entries)[entry.duplicate_of].integrity;
+      ++stats->duplicates;
+      stats->deduplicated_bytes += entry.size;
+    } else if (entry.aligned) {
+      ++stats->aligned_files;
+    }
+  }
+  stats->padding_bytes = payload_size;
+  for (size_t index : stored)
+    stats->padding_bytes -= (*entries)[index].size;
+
+  ScopedFD fd(OpenForWrite(dest));
+  if (fd.get() < 0) {
+    *error = dest.string() + ": failed to create";
+    return false;
+  }
+  if (!Truncate(fd.get(), header_size + payload_size)) {
+    *error = dest.string() + ": failed to allocate";
+    return false;
+  }
+  if (!PackFiles(entries, stored, fd.get(), header_size, options.concurrency, error))
+    return false;
+
+  if (!BuildHeader(*entries, options.header_format, header_size, &header, error))
+    return false;
+  if (header.size() != header_size) {
+    *error = "header size changed while packing";
+    return false;
+  }
+  if (!WriteToFD(fd.get(), 0, header.data(), header.size()) || !fd.Close()) {
+    *error = dest.string() + ": failed to write";
+    return false;
+  }
+
+  stats->files = files.size();
+  stats->bytes = payload_size;
+  stats->header_size = header_size;
+  return true;
+}
+
+// Reads the header of the archive |fd| at |path| as JSON, whatever its
+// format. |header_size| includes the size pickle.
+bool ReadArchiveHeader(int fd,
+                       const fs::path& path,
+                       nlohmann::json* root,
+                       HeaderFormat* format,
+                       uint64_t* header_size,
+                       std::string* error) {
+  uint32_t size_pickle[2];
+  if (!ReadFromFD(fd, 0, reinterpret_cast<char*>(size_pickle), sizeof(size_pickle))) {
+    *error = path.string() + ": failed to read";
+    return false;
+  }
+  const uint32_t size = size_pickle[1];
+  *header_size = sizeof(size_pickle) + uint64_t{size};
+
+  if (size_pickle[0] == BinaryHeader::kPickleMarker) {
+    // The table must be 8-byte aligned.
+    std::vector<uint64_t> table((size + 7) / 8);
+    BinaryHeader binary;
+    if (!ReadFromFD(fd, sizeof(size_pickle), reinterpret_cast<char*>(table.data()), size) ||
+        !binary.Init(reinterpret_cast<const char*>(table.data()), size)) {
+      *error = path.string() + ": invalid binary header";
+      return false;
+    }
+    *root = binary.ToJson();
+    *format = HeaderFormat::kBinary;
+    return true;
+  }
+
+  std::string pickle(size, '\0');
+  uint32_t json_size = 0U;
+  if (size_pickle[0] != sizeof(uint32_t) || size < 2 * sizeof(uint32_t) ||
+      !ReadFromFD(fd, sizeof(size_pickle), pickle.data(), size)) {
+    *error = path.string() + ": not an asar archive";
+    return false;
+  }
+  std::memcpy(&json_size, pickle.data() + sizeof(uint32_t), sizeof(json_size));
+  if (json_size > size - 2 * sizeof(uint32_t)) {
+    *error = path.string() + ": invalid header";
+    return false;
+  }
+  *root = nlohmann::json::parse(pickle.data() + 2 * sizeof(uint32_t),
+                                pickle.data() + 2 * sizeof(uint32_t) + json_size, nullptr, false);
+  if (root->is_discarded() || !root->is_object()) {
+    *error = path.string() + ": invalid header";
+    return false;
+  }
+  *format = HeaderFormat::kJson;
+  return true;
+}
+
+// The largest alignment, from 4096 to 2 MiB, that a payload below |node|
+// starts on, 0 if none does. |header_size| includes the size pickle.
+uint64_t PayloadAlignment(const nlohmann::json& node, uint64_t header_size) {
+  constexpr uint64_t kMinAlignment = 4096;
+  constexpr uint64_t kMaxAlignment = 2 * 1024 * 1024;
+  uint64_t alignment = 0U;
+  if (node.contains("files") && node["files"].is_object()) {
+    for (const auto& [name, child] : node["files"].items())
+      alignment = std::max(alignment, PayloadAlignment(child, header_size));
+    return alignment;
+  }
+  const auto size = node.find("size");
+  const auto unpacked = node.find("unpacked");
+  if (!node.contains("offset") || !node["offset"].is_string() || size == node.end() ||
+      !size->is_number_unsigned() || size->get<uint64_t>() == 0 ||
+      (unpacked != node.end() && unpacked->is_boolean() && unpacked->get<bool>()))
+    return 0U;
+  const uint64_t offset = header_size + std::strtoull(node["offset"].get<std::string>().c_str(), nullptr, 10);
+  alignment = std::min(offset & (~offset + 1), kMaxAlignment);
+  return alignment >= kMinAlignment ? alignment : 0U;
+}
+
+// Copies |size| bytes at |offset| of |in_fd| to |out_offset| of |out_fd|.
+bool CopyRange(int in_fd, uint64_t offset, uint64_t size, int out_fd, uint64_t out_offset) {
+  constexpr uint64_t kChunkSize = 4 * 1024 * 1024;
+  std::vector<char> buffer(static_cast<size_t>(std::min(size, kChunkSize)));
+  for (uint64_t copied = 0; copied < size; copied += buffer.size()) {
+    const size_t chunk = static_cast<size_t>(std::min<uint64_t>(size - copied, buffer.size()));
+    if (!ReadFromFD(in_fd, offset + copied, buffer.data(), chunk) ||
+        !WriteToFD(out_fd, out_offset + copied, buffer.data(), chunk))
+      return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool PackArchive(const fs::path& source,
+                 const fs::path& dest,
+                 const PackOptions& options,
+                 PackStats* stats,
+                 std::string* error) {
+  std::error_code ec;
+  const fs::path root = fs::canonical(source, ec);
+  if (ec) {
+    *error = Describe(source, ec);
+    return false;
+  }
+  if (!fs::is_directory(root)) {
+    *error = source.string() + ": not a directory";
+    return false;
+  }
+  if (options.block_size == 0) {
+    *error = "block size must not be 0";
+    return false;
+  }
+  if (options.alignment % 4096 != 0 || (options.alignment & (options.alignment - 1)) != 0) {
+    *error = "alignment must be a power of two of at least 4096";
+    return false;
+  }
+
+  std::vector<Entry> entries;
+  if (!WalkTree(root, options.concurrency, &entries, error))
+    return false;
+
+  std::vector<size_t> files;
+  CollectFiles(entries, 0, &files);
+
+  *stats = PackStats();
+  const fs::path temp = dest.string() + ".tmp";
+  if (!WriteArchive(&entries, files, temp, options, stats, error)) {
+    fs::remove(temp, ec);
+    return false;
+  }
+  fs::rename(temp, dest, ec);
+  if (ec) {
+    *error = Describe(dest, ec);
+    fs::remove(temp, ec);
+    return false;
+  }
+
+  for (const Entry& entry : entries) {
+    if (entry.type == Archive::FileType::kDirectory)
+      ++stats->directories;
+    else if (entry.type == Archive::FileType::kLink)
+      ++stats->links;
+  }
+  // The root is not an entry of the archive.
+  --stats->directories;
+  return true;
+}
+
+bool ConvertArchive(const fs::path& path,
+                    HeaderFormat format,
+                    ConvertStats* stats,
+                    std::string* error) {
+  *stats = ConvertStats();
+  ScopedFD in(OpenForRead(path));
+  if (in.get() < 0) {
+    *error = path.string() + ": failed to open";
+    return false;
+  }
+  nlohmann::json root;
+  HeaderFormat old_format = HeaderFormat::kJson;
+  uint64_t old_size = 0U;
+  if (!ReadArchiveHeader(in.get(), path, &root, &old_format, &old_size, error))
+    return false;
+  stats->old_header_size = old_size;
+  stats->header_size = old_size;
+  if (old_format == format) {
+    stats->unchanged = true;
+    return true;
+  }
+
+  std::string header;
+  if (!SerializeHeader(root, format, old_size, &header, error))
+    return false;
+  // Readers map binary headers, only JSON ones, parsed once when opening,
+  // are overwritten.
+  if (old_format == HeaderFormat::kJson && header.size() == old_size) {
+    in.Close();
+    ScopedFD out(OpenForUpdate(path));
+    if (out.get() < 0 || !WriteToFD(out.get(), 0, header.data(), header.size()) ||
+        !Sync(out.get()) || !out.Close()) {
+      *error = path.string() + ": failed to write";
+      return false;
+    }
+    stats->in_place = true;
+    return true;
+  }
+
+  const uint64_t alignment = PayloadAlignment(root, old_size);
+  if (alignment > 0) {
+    const uint64_t growth = (header.size() - old_size + alignment - 1) / alignment * alignment;
+    if (!SerializeHeader(root, format, old_size + growth, &header, error))
+      return false;
+  }
+
+  std::error_code ec;
+  const uint64_t file_size = fs::file_size(path, ec);
+  if (ec || file_size < old_size) {
+    *error = ec ? Describe(path, ec) : path.string() + ": truncated archive";
+    return false;
+  }
+  const fs::path temp = path.string() + ".tmp";
+  ScopedFD out(OpenForWrite(temp));
+  bool ok = out.get() >= 0 && WriteToFD(out.get(), 0, header.data(), header.size()) &&
+            CopyRange(in.get(), old_size, file_size - old_size, out.get(), header.size()) &&
+            Sync(out.get());
+  ok = out.Close() && ok;
+  if (ok)
+    fs::rename(temp, path, ec);
+  if (!ok || ec) {
+    *error = ec ? Describe(path, ec) : temp.string() + ": failed to write";
+    fs::remove(temp, ec);
+    return false;
+  }
+  stats->header_size = header.size();
+  return true;
+}
+
+}  // namespace asar
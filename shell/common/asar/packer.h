@@ -0,0 +1,112 @@
+#ifndef ELECTRON_SHELL_COMMON_ASAR_PACKER_H_
+#define ELECTRON_SHELL_COMMON_ASAR_PACKER_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace asar {
+
+enum class HeaderFormat {
+  // The JSON header every asar reader understands.
+  kJson,
+  // The table of BinaryHeader, only read by this addon.
+  kBinary,
+};
+
+struct PackOptions {
+  // Threads walking, hashing and copying, 0 for one per core.
+  unsigned concurrency = 0U;
+  // Size of the integrity blocks, also the size of the reads.
+  uint32_t block_size = 4 * 1024 * 1024;
+  // Stores files with the same content once, all their entries point at
+  // the same offset.
+  bool deduplicate = false;
+  // Starts the payloads of selected files at a multiple of |alignment|
+  // bytes in the archive file, e.g. 4096 or 2 MiB, so that they can be
+  // mapped on their own, see Archive::MapFile. 0 turns alignment off.
+  uint64_t alignment = 0U;
+  // Files selected for alignment: by extension, or by size when
+  // |align_min_size| is not 0.
+  std::vector<std::string> align_extensions = {".node", ".wasm"};
+  uint64_t align_min_size = 1024 * 1024;
+  HeaderFormat header_format = HeaderFormat::kJson;
+};
+
+struct PackStats {
+  uint64_t files = 0U;
+  uint64_t directories = 0U;
+  uint64_t links = 0U;
+  // Size of the payloads.
+  uint64_t bytes = 0U;
+  // Files sharing the payload of another file, and their size.
+  uint64_t duplicates = 0U;
+  uint64_t deduplicated_bytes = 0U;
+  uint64_t aligned_files = 0U;
+  // Zeros between payloads for alignment, included in |bytes|.
+  uint64_t padding_bytes = 0U;
+  // Size of the size pickle and the header pickle before the payloads.
+  uint64_t header_size = 0U;
+};
+
+struct ConvertStats {
+  // Size of the size pickle and the header before and after converting.
+  uint64_t old_header_size = 0U;
+  uint64_t header_size = 0U;
+  // Whether only the header was rewritten, the payloads staying in place.
+  bool in_place = false;
+  // Whether the header already had the requested format, nothing was written.
+  bool unchanged = false;
+};
+
+// Packs the directory |source| into an asar archive at |dest|, with file
+// and block integrity as @electron/asar writes it.
+//
+// The tree is listed one level at a time, each level's directories in
+// parallel. As all hashes have the same length the header size is known
+// before any file is read, so every file is read once, on any thread, and
+// written right away to its final place in the archive, block by block.
+// The header goes in last. The archive is written next to |dest| and
+// renamed over it, so readers never see a partial archive.
+//
+// When deduplicating, only files of the same size as another file can be
+// duplicates. Those are hashed first, the files with a content hash seen
+// before get the offset of the first one, and only the others are copied
+// afterwards. Files of a unique size are still read only once.
+//
+// Aligned payloads are preceded by zeros up to the next multiple of the
+// alignment. The header is padded up to the size the offsets were aligned
+// for, the padding is part of the header pickle.
+//
+// Returns false and sets |error| on failure.
+bool PackArchive(const std::filesystem::path& source,
+                 const std::filesystem::path& dest,
+                 const PackOptions& options,
+                 PackStats* stats,
+                 std::string* error);
+
+// Rewrites the header of the archive at |path| in |format|, leaving the
+// payloads as they are.
+//
+// A binary header that fits in the space of an old JSON one is padded to
+// its size, written over it in place and flushed to the disk. The archive
+// must not be in use then: a reader opening it meanwhile can see a partial
+// header. Readers that had it open see it modified and reload it, see
+// Archive::IsStale.
+//
+// Otherwise, and always for old binary headers which readers map, the
+// archive is copied behind the new header next to |path| and renamed over
+// it, so that open archives keep their file. The header then grows by a
+// multiple of the largest page alignment found among the payloads, up to
+// 2 MiB, so that aligned payloads stay aligned.
+//
+// Returns false and sets |error| on failure.
+bool ConvertArchive(const std::filesystem::path& path,
+                    HeaderFormat format,
+                    ConvertStats* stats,
+                    std::string* error);
+
+}  // namespace asar
+
+#endif  // ELECTRON_SHELL_COMMON_ASAR_PACKER_H_
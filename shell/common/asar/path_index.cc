@@ -0,0 +1,207 @@
+#include "path_index.h"
+
+#include <mutex>
+
+namespace asar {
+
+namespace {
+
+#if defined(_WIN32)
+constexpr char kSeparator = '\\';
+#else
+constexpr char kSeparator = '/';
+#endif
+
+bool IsSeparator(char c) {
+#if defined(_WIN32)
+  return c == '/' || c == '\\';
+#else
+  return c == '/';
+#endif
+}
+
+// Whether |path| has no empty, "." or ".." components, which the index
+// keys never have.
+bool IsNormalized(std::string_view path) {
+  size_t begin = 0;
+  for (size_t i = 0; i <= path.size(); ++i) {
+    if (i < path.size() && !IsSeparator(path[i]))
+      continue;
+    const std::string_view component = path.substr(begin, i - begin);
+    if ((component.empty() && begin > 0) || component == "." || component == "..")
+      return false;
+    begin = i + 1;
+  }
+  return true;
+}
+
+}  // namespace
+
+PathIndex& PathIndex::GetInstance() {
+  static PathIndex* index = new PathIndex();
+  return *index;
+}
+
+PathIndex::PathIndex() = default;
+
+PathIndex::~PathIndex() = default;
+
+void PathIndex::SetEnabled(bool enabled) {
+  std::unique_lock<std::shared_mutex> lock(lock_);
+  enabled_ = enabled;
+  if (!enabled) {
+    entries_.clear();
+    shadowed_.clear();
+    archives_.clear();
+  }
+}
+
+void PathIndex::AddArchive(const std::string& archive_path, const Archive& archive) {
+  std::vector<Archive::WalkEntry> walked;
+  if (!enabled() || !archive.Walk(std::filesystem::path(), 0, &walked))
+    return;
+
+  std::unique_lock<std::shared_mutex> lock(lock_);
+  RemoveArchiveLocked(archive_path);
+
+  // Fill the buffer completely before taking views into it.
+  IndexedArchive& indexed = archives_[archive_path];
+  indexed.depth = archive_path.size();
+  indexed.access_epoch.store(access_epoch_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  size_t size = archive_path.size();
+  for (const auto& entry : walked)
+    size += archive_path.size() + 1 + entry.path.size();
+  indexed.paths.reserve(size);
+  indexed.paths.append(archive_path);
+  std::vector<size_t> ends;
+  ends.reserve(walked.size() + 1);
+  ends.push_back(indexed.paths.size());
+  for (const auto& entry : walked) {
+    indexed.paths.append(archive_path);
+    indexed.paths.push_back(kSeparator);
+    indexed.paths.append(entry.path);
+    ends.push_back(indexed.paths.size());
+  }
+
+  const std::string_view paths(indexed.paths);
+  indexed.keys.reserve(ends.size());
+  size_t begin = 0;
+  for (size_t i = 0; i < ends.size(); ++i) {
+    const std::string_view key = paths.substr(begin, ends[i] - begin);
+    const Entry entry{i == 0 ? Archive::FileType::kDirectory : walked[i - 1].type, &indexed};
+    indexed.keys.push_back(key);
+    begin = ends[i];
+
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+      entries_.emplace(key, entry);
+    } else if (it->second.owner->depth < indexed.depth) {
+      // Rekey the entry to the view of its new owner.
+      auto node = entries_.extract(it);
+      shadowed_.emplace(node.key(), node.mapped());
+      node.key() = key;
+      node.mapped() = entry;
+      entries_.insert(std::move(node));
+    } else {
+      shadowed_.emplace(key, entry);
+    }
+  }
+}
+
+void PathIndex::RemoveArchive(const std::string& archive_path) {
+  std::unique_lock<std::shared_mutex> lock(lock_);
+  RemoveArchiveLocked(archive_path);
+}
+
+void PathIndex::RemoveArchiveLocked(const std::string& archive_path) {
+  auto it = archives_.find(archive_path);
+  if (it == archives_.end())
+    return;
+  const IndexedArchive* indexed = &it->second;
+  for (const std::string_view& key : indexed->keys) {
+    auto shadows = shadowed_.equal_range(key);
+    auto entry = entries_.find(key);
+    if (entry->second.owner != indexed) {
+      for (auto shadow = shadows.first; shadow != shadows.second; ++shadow) {
+        if (shadow->second.owner == indexed) {
+          shadowed_.erase(shadow);
+          break;
+        }
+      }
+      continue;
+    }
+
+    // Hand the path over to the deepest archive left, if any.
+    auto next = shadows.first;
+    for (auto shadow = shadows.first; shadow != shadows.second; ++shadow) {
+      if (shadow->second.owner->depth > next->second.owner->depth)
+        next = shadow;
+    }
+    if (next == shadows.second) {
+      entries_.erase(entry);
+      continue;
+    }
+    auto node = entries_.extract(entry);
+    node.key() = next->first;
+    node.mapped() = next->second;
+    entries_.insert(std::move(node));
+    shadowed_.erase(next);
+  }
+  archives_.erase(it);
+}
+
+PathIndex::Result PathIndex::Find(std::string_view path, Archive::FileType* type) const {
+  std::shared_lock<std::shared_mutex> lock(lock_);
+  if (entries_.empty() || !IsNormalized(path))
+    return Result::kNotIndexed;
+
+  auto it = entries_.find(path);
+  if (it != entries_.end()) {
+    Touch(*it->second.owner);
+    *type = it->second.type;
+    return Result::kFound;
+  }
+
+  // Missing below an indexed directory or file, or outside all archives.
+  for (size_t end = path.rfind(kSeparator); end != std::string_view::npos && end > 0;
+       end = path.rfind(kSeparator, end - 1)) {
+    auto parent = entries_.find(path.substr(0, end));
+    if (parent != entries_.end()) {
+      Touch(*parent->second.owner);
+      // What is below a link depends on its target.
+      return parent->second.type == Archive::FileType::kLink ? Result::kNotIndexed
+                                                             : Result::kNotFound;
+    }
+  }
+  return Result::kNotIndexed;
+}
+
+bool PathIndex::WasAccessed(const std::string& archive_path) const {
+  std::shared_lock<std::shared_mutex> lock(lock_);
+  auto it = archives_.find(archive_path);
+  return it != archives_.end() &&
+         it->second.access_epoch.load(std::memory_order_relaxed) ==
+             access_epoch_.load(std::memory_order_relaxed);
+}
+
+void PathIndex::AdvanceAccessEpoch() {
+  access_epoch_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PathIndex::Touch(const IndexedArchive& indexed) const {
+  const uint64_t epoch = access_epoch_.load(std::memory_order_relaxed);
+  if (indexed.access_epoch.load(std::memory_order_relaxed) != epoch)
+    indexed.access_epoch.store(epoch, std::memory_order_relaxed);
+}
+
+PathIndex::Counters PathIndex::GetCounters() const {
+  std::shared_lock<std::shared_mutex> lock(lock_);
+  Counters counters;
+  counters.archives = archives_.size();
+  counters.entries = entries_.size();
+  for (const auto& [archive_path, indexed] : archives_)
+    counters.bytes += indexed.paths.capacity();
+  return counters;
+}
+
+}  // namespace asar
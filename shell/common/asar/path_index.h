@@ -0,0 +1,102 @@
+#ifndef ELECTRON_SHELL_COMMON_ASAR_PATH_INDEX_H_
+#define ELECTRON_SHELL_COMMON_ASAR_PATH_INDEX_H_
+
+#include <atomic>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "./archive.h"
+
+namespace asar {
+
+// Indexes the entries of all opened archives by absolute path, so that
+// probing a path, e.g. during module resolution, is a single hash lookup
+// instead of splitting the path, finding its archive and walking the tree.
+//
+// Archives are added as they are opened and removed when unloaded. The
+// paths of an archive are kept in one buffer that the keys point into. A
+// path indexed by several archives, e.g. the root of an archive nested in
+// another one, reports the entry of the deepest archive and stays indexed
+// until all of them are removed.
+class PathIndex {
+ public:
+  enum class Result {
+    // |path| is not inside an indexed archive.
+    kNotIndexed,
+    kNotFound,
+    kFound,
+  };
+
+  struct Counters {
+    uint64_t archives = 0U;
+    uint64_t entries = 0U;
+    // Size of the path buffers.
+    uint64_t bytes = 0U;
+  };
+
+  static PathIndex& GetInstance();
+
+  // Disabling drops all entries.
+  void SetEnabled(bool enabled);
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  // Indexes |archive| opened at |archive_path|, replacing the entries
+  // indexed for that path before.
+  void AddArchive(const std::string& archive_path, const Archive& archive);
+  void RemoveArchive(const std::string& archive_path);
+
+  // Looks up the normalized absolute |path|. Paths missing from an indexed
+  // archive are told from paths outside of all of them by their closest
+  // indexed ancestor. Links are reported as found with their own type.
+  Result Find(std::string_view path, Archive::FileType* type) const;
+
+  // Whether Find answered from the archive indexed at |archive_path| since
+  // the last AdvanceAccessEpoch, or it was indexed since.
+  bool WasAccessed(const std::string& archive_path) const;
+  void AdvanceAccessEpoch();
+
+  Counters GetCounters() const;
+
+ private:
+  struct IndexedArchive {
+    // Length of the archive path, the deeper archive wins a shared path.
+    size_t depth = 0U;
+    std::string paths;
+    // All paths of the archive, also the ones shadowed by another archive.
+    std::vector<std::string_view> keys;
+    // Access epoch of the last Find answered from the archive.
+    mutable std::atomic<uint64_t> access_epoch{0};
+  };
+
+  struct Entry {
+    Archive::FileType type;
+    const IndexedArchive* owner;
+  };
+
+  PathIndex();
+  ~PathIndex();
+
+  void RemoveArchiveLocked(const std::string& archive_path);
+
+  // Marks |indexed| as accessed in the current access epoch.
+  void Touch(const IndexedArchive& indexed) const;
+
+  std::atomic<bool> enabled_{false};
+  std::atomic<uint64_t> access_epoch_{0};
+
+  mutable std::shared_mutex lock_;
+  // The keys point into the paths of their owner.
+  std::unordered_map<std::string_view, Entry> entries_;
+  // Entries of paths also indexed by a deeper archive, taking over when it
+  // is removed.
+  std::unordered_multimap<std::string_view, Entry> shadowed_;
+  std::unordered_map<std::string, IndexedArchive> archives_;
+};
+
+}  // namespace asar
+
+#endif  // ELECTRON_SHELL_COMMON_ASAR_PATH_INDEX_H_
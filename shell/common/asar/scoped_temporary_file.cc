@@ -20,6 +20,7 @@
 #endif
 
 #include "./asar_util.h"
+#include "./integrity.h"
 
 namespace asar {
 
@@ -102,35 +103,16 @@ bool ScopedTemporaryFile::InitFromFile(
 
   // Read data from source file descriptor
   std::vector<uint8_t> buf(size);
-
-#if defined(_WIN32)
-  // Seek to offset
-  if (_lseeki64(src_fd, offset, SEEK_SET) == -1) {
+  if (!ReadFromFD(src_fd, offset, reinterpret_cast<char*>(buf.data()), size)) {
     return false;
   }
 
-  // Read data
-  int bytes_read = _read(src_fd, buf.data(), static_cast<unsigned int>(size));
-  if (bytes_read != static_cast<int>(size)) {
-    return false;
-  }
-#else
-  // Seek to offset
-  if (lseek(src_fd, offset, SEEK_SET) == -1) {
-    return false;
-  }
-
-  // Read data
-  ssize_t bytes_read = read(src_fd, buf.data(), size);
-  if (bytes_read != static_cast<ssize_t>(size)) {
-    return false;
-  }
-#endif
-
   // Validate integrity if provided
   if (integrity) {
     std::string_view sv(reinterpret_cast<const char*>(buf.data()), size);
-    ValidateIntegrityOrDie(sv, *integrity);
+    if (!ValidateFileIntegrity(sv, *integrity, HashConcurrency(size))) {
+      std::abort();
+    }
   }
 
   // Write to destination file
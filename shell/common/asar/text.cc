@@ -0,0 +1,142 @@
+#include "text.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ASAR_TEXT_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define ASAR_TEXT_NEON 1
+#endif
+
+namespace asar {
+
+bool IsAscii(const char* data, size_t size) {
+  size_t i = 0;
+
+#if defined(ASAR_TEXT_SSE2)
+  // OR 64 bytes together before testing the high bits, so that the loop
+  // is not bound by the branch.
+  for (; i + 64 <= size; i += 64) {
+    const __m128i* p = reinterpret_cast<const __m128i*>(data + i);
+    __m128i chunk = _mm_or_si128(
+        _mm_or_si128(_mm_loadu_si128(p), _mm_loadu_si128(p + 1)),
+        _mm_or_si128(_mm_loadu_si128(p + 2), _mm_loadu_si128(p + 3)));
+    if (_mm_movemask_epi8(chunk))
+      return false;
+  }
+  for (; i + 16 <= size; i += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    if (_mm_movemask_epi8(chunk))
+      return false;
+  }
+#elif defined(ASAR_TEXT_NEON)
+  for (; i + 64 <= size; i += 64) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data + i);
+    uint8x16_t chunk = vorrq_u8(vorrq_u8(vld1q_u8(p), vld1q_u8(p + 16)),
+                                vorrq_u8(vld1q_u8(p + 32), vld1q_u8(p + 48)));
+    if (vmaxvq_u8(chunk) >= 0x80)
+      return false;
+  }
+  for (; i + 16 <= size; i += 16) {
+    if (vmaxvq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(data + i))) >= 0x80)
+      return false;
+  }
+#endif
+
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    if (word & 0x8080808080808080ULL)
+      return false;
+  }
+  for (; i < size; ++i) {
+    if (static_cast<unsigned char>(data[i]) & 0x80)
+      return false;
+  }
+  return true;
+}
+
+namespace {
+
+bool IsContinuation(uint8_t c) {
+  return (c & 0xC0) == 0x80;
+}
+
+}  // namespace
+
+bool Utf8ToUtf16(const char* data, size_t size, std::u16string* out) {
+  // Every byte yields at most one code unit.
+  out->resize(size);
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+  const uint8_t* const end = p + size;
+  char16_t* o = &(*out)[0];
+
+  while (p < end) {
+#if defined(ASAR_TEXT_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    while (end - p >= 16) {
+      __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      if (_mm_movemask_epi8(chunk))
+        break;
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(o), _mm_unpacklo_epi8(chunk, zero));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(o + 8), _mm_unpackhi_epi8(chunk, zero));
+      p += 16;
+      o += 16;
+    }
+#elif defined(ASAR_TEXT_NEON)
+    while (end - p >= 16) {
+      uint8x16_t chunk = vld1q_u8(p);
+      if (vmaxvq_u8(chunk) >= 0x80)
+        break;
+      vst1q_u16(reinterpret_cast<uint16_t*>(o), vmovl_u8(vget_low_u8(chunk)));
+      vst1q_u16(reinterpret_cast<uint16_t*>(o + 8), vmovl_u8(vget_high_u8(chunk)));
+      p += 16;
+      o += 16;
+    }
+#endif
+    if (p == end)
+      break;
+
+    const uint8_t lead = *p;
+    const size_t left = static_cast<size_t>(end - p);
+    if (lead < 0x80) {
+      *o++ = lead;
+      p += 1;
+    } else if (lead >= 0xC2 && lead <= 0xDF) {
+      if (left < 2 || !IsContinuation(p[1]))
+        return false;
+      *o++ = static_cast<char16_t>(((lead & 0x1F) << 6) | (p[1] & 0x3F));
+      p += 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+      if (left < 3 || !IsContinuation(p[1]) || !IsContinuation(p[2]))
+        return false;
+      // Reject overlong forms and UTF-16 surrogates.
+      if ((lead == 0xE0 && p[1] < 0xA0) || (lead == 0xED && p[1] > 0x9F))
+        return false;
+      *o++ = static_cast<char16_t>(((lead & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F));
+      p += 3;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+      if (left < 4 || !IsContinuation(p[1]) || !IsContinuation(p[2]) || !IsContinuation(p[3]))
+        return false;
+      // Reject overlong forms and code points past U+10FFFF.
+      if ((lead == 0xF0 && p[1] < 0x90) || (lead == 0xF4 && p[1] > 0x8F))
+        return false;
+      const uint32_t code_point = ((lead & 0x07) << 18) | ((p[1] & 0x3F) << 12) |
+                                  ((p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+      // Four bytes make a surrogate pair, still no more units than bytes.
+      *o++ = static_cast<char16_t>(0xD800 + ((code_point - 0x10000) >> 10));
+      *o++ = static_cast<char16_t>(0xDC00 + ((code_point - 0x10000) & 0x3FF));
+      p += 4;
+    } else {
+      return false;
+    }
+  }
+
+  out->resize(static_cast<size_t>(o - out->data()));
+  return true;
+}
+
+}  // namespace asar
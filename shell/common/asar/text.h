@@ -0,0 +1,22 @@
+#ifndef ELECTRON_SHELL_COMMON_ASAR_TEXT_H_
+#define ELECTRON_SHELL_COMMON_ASAR_TEXT_H_
+
+#include <cstddef>
+#include <string>
+
+namespace asar {
+
+// Whether all |size| bytes of |data| are 7-bit ASCII, such text is valid
+// UTF-8 and Latin-1 at the same time. Scans 16 bytes at a time with SSE2 or
+// NEON where available.
+bool IsAscii(const char* data, size_t size);
+
+// Decode the UTF-8 in |data| into |out| in a single pass, widening ASCII runs
+// 16 bytes at a time. Returns false on malformed input (overlong forms,
+// surrogates, code points past U+10FFFF, truncated sequences), |out| is
+// unspecified then.
+bool Utf8ToUtf16(const char* data, size_t size, std::u16string* out);
+
+}  // namespace asar
+
+#endif  // ELECTRON_SHELL_COMMON_ASAR_TEXT_H_
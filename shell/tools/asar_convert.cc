@@ -0,0 +1,56 @@
+// Rewrites the header of asar archives, see asar::ConvertArchive. Archives
+// rewritten in place must not be in use.
+//
+//   asar_convert [--to-json] <archive>...
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common/asar/packer.h"
+
+namespace {
+
+int Usage() {
+  std::cerr << "usage: asar_convert [--to-json] <archive>..." << std::endl;
+  return 2;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  asar::HeaderFormat format = asar::HeaderFormat::kBinary;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg(argv[i]);
+    if (arg == "--to-json") {
+      format = asar::HeaderFormat::kJson;
+    } else if (arg.rfind("--", 0) == 0) {
+      return Usage();
+    } else {
+      paths.emplace_back(arg);
+    }
+  }
+  if (paths.empty())
+    return Usage();
+
+  int status = 0;
+  for (const std::string& path : paths) {
+    asar::ConvertStats stats;
+    std::string error;
+    if (!asar::ConvertArchive(path, format, &stats, &error)) {
+      std::cerr << "asar_convert: " << error << std::endl;
+      status = 1;
+      continue;
+    }
+    if (stats.unchanged) {
+      std::cout << path << ": already " << (format == asar::HeaderFormat::kJson ? "json" : "binary")
+                << std::endl;
+      continue;
+    }
+    std::cout << path << ": header " << stats.old_header_size << " -> " << stats.header_size
+              << " bytes, " << (stats.in_place ? "rewritten in place" : "copied") << std::endl;
+  }
+  return status;
+}
@@ -0,0 +1,110 @@
+// Packs a directory into an asar archive, see asar::PackArchive.
+//
+//   asar_pack [--concurrency=N] [--block-size=BYTES] [--dedup]
+//             [--align=BYTES] [--align-ext=.node,.wasm] [--align-min-size=BYTES]
+//             [--binary-header] <source> <dest>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common/asar/packer.h"
+
+namespace {
+
+int Usage() {
+  std::cerr << "usage: asar_pack [--concurrency=N] [--block-size=BYTES] [--dedup]\n"
+            << "                 [--align=BYTES] [--align-ext=.node,.wasm] [--align-min-size=BYTES]\n"
+            << "                 [--binary-header] <source> <dest>" << std::endl;
+  return 2;
+}
+
+bool ParseNumber(std::string_view value, uint64_t max, uint64_t* number) {
+  char* end = nullptr;
+  const std::string text(value);
+  const unsigned long long parsed = std::strtoull(text.c_str(), &end, 10);
+  if (text.empty() || *end != '\0' || parsed > max)
+    return false;
+  *number = parsed;
+  return true;
+}
+
+std::vector<std::string> SplitList(std::string_view list) {
+  std::vector<std::string> items;
+  while (!list.empty()) {
+    const size_t end = std::min(list.find(','), list.size());
+    if (end > 0)
+      items.emplace_back(list.substr(0, end));
+    list.remove_prefix(std::min(end + 1, list.size()));
+  }
+  return items;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  asar::PackOptions options;
+  std::string paths[2];
+  int path_count = 0;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg(argv[i]);
+    uint64_t number = 0U;
+    if (arg.rfind("--concurrency=", 0) == 0) {
+      if (!ParseNumber(arg.substr(14), 1024, &number))
+        return Usage();
+      options.concurrency = static_cast<unsigned>(number);
+    } else if (arg.rfind("--block-size=", 0) == 0) {
+      if (!ParseNumber(arg.substr(13), UINT32_MAX, &number) || number == 0)
+        return Usage();
+      options.block_size = static_cast<uint32_t>(number);
+    } else if (arg == "--dedup") {
+      options.deduplicate = true;
+    } else if (arg.rfind("--align=", 0) == 0) {
+      if (!ParseNumber(arg.substr(8), uint64_t{1} << 30, &number))
+        return Usage();
+      options.alignment = number;
+    } else if (arg.rfind("--align-ext=", 0) == 0) {
+      options.align_extensions = SplitList(arg.substr(12));
+    } else if (arg.rfind("--align-min-size=", 0) == 0) {
+      if (!ParseNumber(arg.substr(17), UINT64_MAX, &number))
+        return Usage();
+      options.align_min_size = number;
+    } else if (arg == "--binary-header") {
+      options.header_format = asar::HeaderFormat::kBinary;
+    } else if (arg.rfind("--", 0) == 0 || path_count == 2) {
+      return Usage();
+    } else {
+      paths[path_count++] = argv[i];
+    }
+  }
+  if (path_count != 2)
+    return Usage();
+
+  const auto start = std::chrono::steady_clock::now();
+  asar::PackStats stats;
+  std::string error;
+  if (!asar::PackArchive(paths[0], paths[1], options, &stats, &error)) {
+    std::cerr << "asar_pack: " << error << std::endl;
+    return 1;
+  }
+  const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+  std::cout << paths[1] << ": " << stats.files << " files, " << stats.directories
+            << " directories, " << stats.links << " links, " << stats.bytes
+            << " bytes, header " << stats.header_size << " bytes, "
+            << elapsed.count() << " ms" << std::endl;
+  if (options.deduplicate) {
+    std::cout << stats.duplicates << " duplicates, " << stats.deduplicated_bytes
+              << " bytes saved" << std::endl;
+  }
+  if (options.alignment > 0) {
+    std::cout << stats.aligned_files << " aligned files, " << stats.padding_bytes
+              << " bytes of padding" << std::endl;
+  }
+  return 0;
+}
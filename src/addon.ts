@@ -24,15 +24,249 @@ export interface AsarFileInfo {
     }
 }
 
+export interface FileOutLimits {
+    /**
+     * Maximum total bytes of temporary files extracted by `copyFileOut`, 0 means unlimited.
+     */
+    maxBytes?: number;
+    /**
+     * Maximum count of temporary files extracted by `copyFileOut`, 0 means unlimited.
+     */
+    maxEntries?: number;
+}
+
+export interface ExtractTreeOptions {
+    /**
+     * Number of threads used to read and write file contents.
+     * Defaults to the number of CPU cores.
+     */
+    concurrency?: number;
+}
+
+export interface ExtractTreeResult {
+    files: number;
+    links: number;
+    directories: number;
+    bytes: number;
+    elapsedMs: number;
+    bytesPerSecond: number;
+}
+
+export interface IntegrityStats {
+    /** Files validated once and skipped on later reads. */
+    verifiedFiles: number;
+    hashedBytes: number;
+    hashMs: number;
+    /** Reads of already validated files that skipped hashing. */
+    skippedReads: number;
+    skippedBytes: number;
+    /** Hash time saved by skipped reads. */
+    savedMs: number;
+}
+
+export interface VerifyAllEvent {
+    verifiedFiles: number;
+    failedFiles: number;
+    totalFiles: number;
+    verifiedBytes: number;
+    totalBytes: number;
+    /** Set when the event reports a file failing validation. */
+    failedPath?: string;
+}
+
+export interface VerifyAllOptions {
+    /** Number of hashing threads, defaults to the number of CPU cores. */
+    threads?: number;
+}
+
+export interface DirectoryCacheOptions {
+    /** Maximum number of cached paths. @default 8192 */
+    maxEntries?: number;
+    /** Expire cached paths after `ttlMs`, 0 keeps them until invalidated. @default 0 */
+    ttlMs?: number;
+    /**
+     * Invalidate cached paths on changes of their parent directory, Linux only. Paths whose parent
+     * cannot be watched expire after `ttlMs`, or after a second when it is 0. @default true
+     */
+    watch?: boolean;
+}
+
+export interface ArchiveReloadOptions {
+    /** @default true */
+    enabled?: boolean;
+    /** Minimum time between checks of an archive file on access. @default 1000 */
+    checkIntervalMs?: number;
+    /** Check as soon as the directory of an archive changes, Linux only. @default true */
+    watch?: boolean;
+}
+
+export interface ArchiveReloadStats {
+    enabled: boolean;
+    /** Archives replaced by a newer file since startup. */
+    reloads: number;
+}
+
+export interface ArchiveMemoryUsage {
+    path: string;
+    /** Estimated size of the parsed header. */
+    headerBytes: number;
+    /** Size of the path index built from the header. */
+    indexBytes: number;
+    /** Address space of the binary header mapping, paged in on demand. */
+    mappedBytes: number;
+    /** Temporary files copied out of the archive. */
+    extractedFiles: number;
+    extractedBytes: number;
+}
+
+export interface ArchiveMemoryStats {
+    /** Opened archives. */
+    archives: ArchiveMemoryUsage[];
+    /** Unloaded archives not released yet because they are still referenced. */
+    pendingUnloads: number;
+}
+
+export interface PathIndexStats {
+    enabled: boolean;
+    /** Indexed archives, the opened ones. */
+    archives: number;
+    entries: number;
+    /** Memory taken by the indexed paths. */
+    bytes: number;
+}
+
+export interface DirectoryCacheStats {
+    hits: number;
+    misses: number;
+    evictions: number;
+    invalidations: number;
+    /** Lookups that waited for another thread. */
+    contentions: number;
+    /** Lookups cached with a TTL, their parent directory could not be watched. */
+    unwatched: number;
+    entries: number;
+}
+
+export interface Mount {
+    mountPoint: string;
+    target: string;
+}
+
+export interface WalkOptions {
+    /** Levels to descend, 1 lists direct children only. @default 0, unlimited */
+    maxDepth?: number;
+}
+
+export interface WalkResult {
+    paths: string[];
+    types: Uint8Array;
+}
+
 export interface ArchiveBinding {
     // eslint-disable-next-line @typescript-eslint/no-misused-new
     new(archivePath: string): ArchiveBinding;
     getFileInfo(path: string): AsarFileInfo | false;
     stat(path: string): AsarFileStat | false;
+    /**
+     * The type of `path`, or 0 if it does not exist. Cheaper than `stat` as no object is created.
+     */
+    statType(path: string): FileType | 0;
+    /**
+     * The size of `path`, or -1 if it does not exist.
+     */
+    size(path: string): number;
+    /**
+     * Write `[size, offset]` of `path` into `values` and return its type, or 0 if it
+     * does not exist. Lets callers reuse one array instead of allocating per stat.
+     */
+    statInto(path: string, values: Float64Array): FileType | 0;
     readdir(path: string): string[] | false;
+    /**
+     * Names and UV dirent types of the children of `path` in one call.
+     */
+    readdirWithTypes(path: string): { names: string[], types: Uint8Array } | false;
+    /**
+     * All descendants of the directory `path`, depth first, as paths relative to it and their
+     * UV dirent types. Links are not followed.
+     */
+    walk(path: string, options?: WalkOptions): WalkResult | false;
+    /**
+     * Same as `walk`, but runs on the thread pool. Rejects if `path` is not a directory.
+     */
+    walkAsync(path: string, options?: WalkOptions): Promise<WalkResult>;
     realpath(path: string): string | false;
+    /**
+     * Async variants of `getFileInfo`, `stat`, `readdir` and `realpath`, run on the
+     * thread pool and resolved with the same values.
+     */
+    getFileInfoAsync(path: string): Promise<AsarFileInfo | false>;
+    statAsync(path: string): Promise<AsarFileStat | false>;
+    readdirAsync(path: string): Promise<string[] | false>;
+    realpathAsync(path: string): Promise<string | false>;
+    /**
+     * Read a packed file, or `length` bytes of it at `position`. Integrity blocks
+     * touched by the read are validated, throws on integrity violation.
+     * With an `encoding` the content is decoded natively into a string.
+     */
+    read(path: string, position?: number, length?: number): Buffer | false;
+    read(path: string, position: number | undefined, length: number | undefined, encoding: 'utf8' | 'utf-8' | 'latin1' | 'binary'): string | false;
+    /**
+     * Read a packed file as a UTF-8 string. ASCII content is exposed without
+     * copying where the runtime supports external strings, throws on
+     * integrity violation.
+     */
+    readSource(path: string): string | false;
+    /**
+     * Map the packed file `path` on its own, zero-copy. Writes to the buffer
+     * stay private to it. Files packed with `asar_pack --align` start at a
+     * page boundary. Throws on integrity violation.
+     */
+    mapEntry(path: string): ArrayBuffer | false;
+    /**
+     * Validate `buffer` read out of the packed file `path`, files already
+     * validated are not hashed again.
+     */
+    validateIntegrity(path: string, buffer: Buffer): boolean;
+    getIntegrityStats(): IntegrityStats;
+    /**
+     * Validate all files of the archive in the background, so that later reads
+     * skip hashing. Progress and failures are reported to `callback`.
+     */
+    verifyAll(options?: VerifyAllOptions, callback?: (event: VerifyAllEvent) => void): Promise<VerifyAllEvent>;
     copyFileOut(path: string): string | false;
-    getFdAndValidateIntegrityLater(): number | -1;
+    /**
+     * Same with `copyFileOut`, but the temporary file will not be evicted
+     * until `releaseFileOut` is called with the same path.
+     */
+    acquireFileOut(path: string): string | false;
+    releaseFileOut(path: string): boolean;
+    /**
+     * Limit temporary files extracted by `copyFileOut`, least recently used
+     * files not acquired by `acquireFileOut` are removed when exceeded.
+     */
+    setFileOutLimits(limits: FileOutLimits): void;
+    /**
+     * Extract the directory `path` of the archive into `destDir` on real disk,
+     * throws if any entry fails to extract or fails the integrity check.
+     */
+    extractTree(path: string, destDir: string, options?: ExtractTreeOptions): ExtractTreeResult;
+    /** Same as `extractTree`, extracting on the libuv thread pool. */
+    extractTreeAsync(path: string, destDir: string, options?: ExtractTreeOptions): Promise<ExtractTreeResult>;
+    /**
+     * The fd to read packed files from at their offset, the one of the layer holding
+     * `path` for overlay archives. The fd stays open across reloads until it is
+     * passed to `releaseFd`.
+     */
+    getFdAndValidateIntegrityLater(path?: string): number | -1;
+    /** Release an fd from `getFdAndValidateIntegrityLater`, false if it was not handed out. */
+    releaseFd(fd: number): boolean;
+    /**
+     * Switch to the reloaded archive after the file was replaced, see `ArchiveReloadOptions`.
+     * Returns whether the archive changed.
+     */
+    refresh(): boolean;
+    /** Approximate memory held by the archive, `null` once unloaded. */
+    getMemoryUsage(): ArchiveMemoryUsage | null;
     readonly archivePath: string;
 }
 
@@ -42,4 +276,35 @@ export type splitPath = (path: string) => (false
 );
 
 export const Archive: ArchiveBinding = addon.Archive;
-export const splitPath: splitPath = addon.splitPath;
\ No newline at end of file
+export const splitPath: splitPath = addon.splitPath;
+/**
+ * Like `splitPath`, but only for paths inside archives passed to `registerArchive`,
+ * never touches the disk.
+ */
+export const splitArchivePath: (path: string) => (false
+    | { isAsar: true, asarPath: string, filePath: string }
+) = addon.splitArchivePath;
+export const registerArchive: (archivePath: string) => void = addon.registerArchive;
+export const configureDirectoryCache: (options: DirectoryCacheOptions) => void = addon.configureDirectoryCache;
+export const getDirectoryCacheStats: () => DirectoryCacheStats = addon.getDirectoryCacheStats;
+export const configureArchiveReload: (options: ArchiveReloadOptions) => void = addon.configureArchiveReload;
+export const getArchiveReloadStats: () => ArchiveReloadStats = addon.getArchiveReloadStats;
+export const setArchiveLayers: (archivePath: string, layers: string[]) => void = addon.setArchiveLayers;
+export const setPathIndexEnabled: (enabled: boolean) => void = addon.setPathIndexEnabled;
+/**
+ * `internalModuleStat` answered from the path index, false when `path` is not in an indexed archive.
+ */
+export const indexedModuleStat: (path: string) => 0 | 1 | -34 | false = addon.indexedModuleStat;
+export const getPathIndexStats: () => PathIndexStats = addon.getPathIndexStats;
+export const unloadArchive: (archivePath: string) => ArchiveMemoryUsage | false = addon.unloadArchive;
+/**
+ * Unload the opened archives not accessed since the last call, natively, through the path index,
+ * or through one of the `used` archives. Returns the unloaded archive paths.
+ */
+export const unloadIdleArchives: (used: string[]) => string[] = addon.unloadIdleArchives;
+export const getArchiveMemoryStats: () => ArchiveMemoryStats = addon.getArchiveMemoryStats;
+export const addMount: (mountPoint: string, target: string) => void = addon.addMount;
+export const removeMount: (mountPoint: string) => boolean = addon.removeMount;
+export const resolveMount: (filepath: string) => string | null = addon.resolveMount;
+export const getMounts: () => Mount[] = addon.getMounts;
+export const setIntegrityValidationEnabled: (enabled: boolean) => void = addon.setIntegrityValidationEnabled;
\ No newline at end of file
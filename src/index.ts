@@ -1,6 +1,7 @@
 /* eslint-disable @typescript-eslint/no-require-imports */
 import './node/original-fs';
 import {archives, getOrCreateArchive, type LoadArchiveOptions} from './node/archives';
+import {getArchiveReloadStats, getDirectoryCacheStats, getPathIndexStats} from './addon';
 type RegisterOptions = LoadArchiveOptions;
 
 let _registed = false;
@@ -16,4 +17,7 @@ module.exports = {
     register,
     getOrCreateArchive,
     archives,
+    getDirectoryCacheStats,
+    getArchiveReloadStats,
+    getPathIndexStats,
 };
\ No newline at end of file
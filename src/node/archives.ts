@@ -21,19 +21,76 @@ export interface LoadArchiveOptions {
      * @default true
      */
     mirrorAsarBasePath?: boolean;
+    /**
+     * Limit temporary files extracted out of the archives, e.g. for `child_process` and `process.dlopen`.
+     * Files opened through `fs` are kept until closed, loaded addons for good.
+     * @default unlimited
+     */
+    fileOutLimits?: asar.FileOutLimits;
+    /**
+     * Validate file contents with the integrity info written into the archive
+     * header by `@electron/asar`. The header itself is trusted.
+     * @default false
+     */
+    validateIntegrity?: boolean;
+    /**
+     * Cache of directory probes for "*.asar" paths outside registered archives.
+     */
+    directoryCache?: asar.DirectoryCacheOptions;
+    /**
+     * Reload archives whose file is replaced while the process runs, e.g. by a deploy.
+     * Already running operations finish with the old archive.
+     */
+    reload?: asar.ArchiveReloadOptions;
+    /**
+     * Open archives as overlays of patch archives stacked over them, lowest first, e.g.
+     * `{'/opt/app/app.asar': ['/opt/app/hotfix.asar']}`. Files of upper layers shadow the
+     * lower ones, `.wh.<name>` entries delete `<name>` and `.wh..wh..opq` a whole directory.
+     */
+    overlays?: Record<string, string[]>;
+    /**
+     * Index the paths of all opened archives in one hash table, so that module resolution
+     * probes are answered with a single lookup. Registered archives are opened eagerly.
+     * @default false
+     */
+    pathIndex?: boolean;
+    /**
+     * Unload archives not accessed for about this long, they are opened again on the next access.
+     * @default 0, never
+     */
+    unloadIdleMs?: number;
+    /**
+     * Extra module mappings from a directory to a location inside an archive,
+     * e.g. `{'/opt/app/plugins': '/opt/app/plugins.asar/dist'}`.
+     * The deepest matching mount point wins, target archives must also be listed in `archives`.
+     */
+    mounts?: Record<string, string>;
 }
 
 // Cache asar archive objects.
 const cachedArchives = new Map<string, asar.ArchiveBinding>();
+// Archives accessed since the last idle sweep, tracked while idle unloading is enabled.
+const usedArchives = new Set<string>();
+let idleSweepTimer: ReturnType<typeof setInterval> | null = null;
 
 export const getOrCreateArchive = (archivePath: string) => {
+  if (idleSweepTimer) {
+    usedArchives.add(archivePath);
+  }
   const isCached = cachedArchives.has(archivePath);
   if (isCached) {
-    return cachedArchives.get(archivePath)!;
+    const archive = cachedArchives.get(archivePath)!;
+    if (archives._reloadEnabled) {
+      archive.refresh();
+    }
+    return archive;
   }
 
   try {
     const newArchive = new asar.Archive(archivePath);
+    if (archives._fileOutLimits) {
+      newArchive.setFileOutLimits(archives._fileOutLimits);
+    }
     cachedArchives.set(archivePath, newArchive);
     return newArchive;
   } catch {
@@ -48,17 +105,20 @@ export const enum ArchiveType {
 
 class AsarArchives {
   private _archives: Map<string, ArchiveType>;
-  private _mappingLookups: Map<string, string>;
+  // Mirrors whether the native mount table is empty, to skip the call.
+  private _hasMounts = false;
   _isAsarDisabled = false;
+  _fileOutLimits: asar.FileOutLimits | null = null;
+  _reloadEnabled = false;
+  _pathIndexEnabled = false;
 
   constructor() {
     this._archives = new Map();
-    this._mappingLookups = new Map();
   }
 
   private _addMappingLookup(archivePath: string) {
     const mappingDir = archivePath.replace(/\.asar/i, '');
-    this._mappingLookups.set(mappingDir, archivePath);
+    this.mount(mappingDir, archivePath);
     const info = statSync(mappingDir, {throwIfNoEntry: false});
     console.info(`[Info] AsarArchives: Asar mapping lookup added: ${
       archivePath} -> ${mappingDir}${info ? ' (mixed dir)' : ' (mirror dir)'}`);
@@ -79,7 +139,13 @@ class AsarArchives {
       }
     }
     else if (fileInfo.isFile()) {
+      if (!/\.asar$/i.test(archiveFile)) {
+        // Paths are only split at "*.asar" components, files inside it could never be found.
+        console.warn(`[Warning] AsarArchives: Archive file name does not end with .asar: ${archiveFile}`);
+        return;
+      }
       this._archives.set(archiveFile, ArchiveType.File);
+      asar.registerArchive(archiveFile);
       if (options.mirrorAsarBasePath) {
         this._addMappingLookup(archiveFile);
       }
@@ -98,6 +164,38 @@ class AsarArchives {
     const paths = options.archives || [];
     const throwIfNoEntry = !!options.throwIfNoEntry;
     const mirrorAsarBasePath = options.mirrorAsarBasePath !== false;
+    if (options.fileOutLimits) {
+      this._fileOutLimits = options.fileOutLimits;
+    }
+    if (options.validateIntegrity) {
+      asar.setIntegrityValidationEnabled(true);
+    }
+    if (options.directoryCache) {
+      asar.configureDirectoryCache(options.directoryCache);
+    }
+    if (options.reload) {
+      asar.configureArchiveReload(options.reload);
+      this._reloadEnabled = options.reload.enabled !== false;
+    }
+    if (options.unloadIdleMs) {
+      this.setUnloadIdle(options.unloadIdleMs);
+    }
+
+    if (options.pathIndex) {
+      asar.setPathIndexEnabled(true);
+      this._pathIndexEnabled = true;
+    }
+    if (options.overlays) {
+      for (const [archivePath, layers] of Object.entries(options.overlays)) {
+        this.setOverlay(path.resolve(archivePath), layers.map((layer) => path.resolve(layer)));
+      }
+    }
+
+    if (options.mounts) {
+      for (const [mountPoint, target] of Object.entries(options.mounts)) {
+        this.mount(path.resolve(mountPoint), path.resolve(target));
+      }
+    }
 
     if (!Array.isArray(paths)) {
       throw new TypeError('Archives paths should be an array of strings');
@@ -122,14 +220,65 @@ class AsarArchives {
     return this._archives.get(archiveFile) === ArchiveType.File;
   }
 
-  resolveArchiveMapping(filepath: string): string | null {
-    if (!this._mappingLookups.size) return null;
-    for (const [lookupDir, asarFile] of this._mappingLookups) {
-      if (filepath.startsWith(lookupDir)) {
-        return asarFile + filepath.slice(lookupDir.length);
-      }
+  mount(mountPoint: string, target: string) {
+    asar.addMount(mountPoint, target);
+    this._hasMounts = true;
+  }
+
+  unmount(mountPoint: string) {
+    const removed = asar.removeMount(mountPoint);
+    this._hasMounts = asar.getMounts().length > 0;
+    return removed;
+  }
+
+  /**
+   * Close the archive, it is opened again on the next access. Returns the memory it held,
+   * released once operations still using it finish, or false if it was not open.
+   */
+  unload(archivePath: string) {
+    cachedArchives.delete(archivePath);
+    usedArchives.delete(archivePath);
+    return asar.unloadArchive(archivePath);
+  }
+
+  /**
+   * Stack `layers` over the archive, lowest first, see `LoadArchiveOptions.overlays`.
+   * An empty array removes the overlay. Takes effect on the next access.
+   */
+  setOverlay(archivePath: string, layers: string[]) {
+    cachedArchives.delete(archivePath);
+    asar.setArchiveLayers(archivePath, layers);
+  }
+
+  /**
+   * Unload archives not accessed for between `idleMs` and twice as long, 0 disables it.
+   */
+  setUnloadIdle(idleMs: number) {
+    if (idleSweepTimer) {
+      clearInterval(idleSweepTimer);
+      idleSweepTimer = null;
     }
-    return null;
+    usedArchives.clear();
+    if (!(idleMs > 0)) return;
+
+    // Lookups in the native registry and the path index are tracked natively, accesses through
+    // cached bindings here.
+    idleSweepTimer = setInterval(() => {
+      for (const archivePath of asar.unloadIdleArchives([...usedArchives])) {
+        cachedArchives.delete(archivePath);
+      }
+      usedArchives.clear();
+    }, idleMs);
+    idleSweepTimer.unref();
+  }
+
+  getMemoryStats() {
+    return asar.getArchiveMemoryStats();
+  }
+
+  resolveArchiveMapping(filepath: string): string | null {
+    if (!this._hasMounts) return null;
+    return asar.resolveMount(filepath);
   }
 }
 
@@ -137,6 +286,29 @@ export const archives = new AsarArchives();
 
 export const asarRe = /\.asar(?:\/|\\|$)/i;
 
+const notAsar = Object.freeze({ isAsar: <const>false });
+
+// Whether `archivePath` may be inside a registered archive, i.e. has a
+// "*.asar" component in any case, the same rule as the native split. Kept to
+// plain char comparisons so that unrelated paths cost next to nothing.
+const mayBeInArchive = (archivePath: string) => {
+  for (let pos = archivePath.indexOf('.'); pos !== -1; pos = archivePath.indexOf('.', pos + 1)) {
+    const end = pos + 5;
+    if (end > archivePath.length) return false;
+    // Setting 0x20 lowercases ASCII letters, no other char maps onto them.
+    if ((archivePath.charCodeAt(pos + 1) | 0x20) !== 0x61 /* a */ ||
+        (archivePath.charCodeAt(pos + 2) | 0x20) !== 0x73 /* s */ ||
+        (archivePath.charCodeAt(pos + 3) | 0x20) !== 0x61 /* a */ ||
+        (archivePath.charCodeAt(pos + 4) | 0x20) !== 0x72 /* r */) {
+      continue;
+    }
+    if (end === archivePath.length) return true;
+    const next = archivePath.charCodeAt(end);
+    if (next === 0x2f /* / */ || next === 0x5c /* \ */) return true;
+  }
+  return false;
+};
+
 // Separate asar package's path from full path.
 export const splitPath = (archivePathOrBuffer: string | Buffer | URL): ({
   isAsar: false;
@@ -146,7 +318,7 @@ export const splitPath = (archivePathOrBuffer: string | Buffer | URL): ({
   filePath: string;
 }) => {
   // Shortcut for disabled asar.
-  if (archives._isAsarDisabled) return { isAsar: false };
+  if (archives._isAsarDisabled) return notAsar;
 
   // Check for a bad argument type.
   let archivePath = archivePathOrBuffer;
@@ -158,19 +330,12 @@ export const splitPath = (archivePathOrBuffer: string | Buffer | URL): ({
       archivePath = getValidatedPath(archivePath);
     }
     else  {
-      return { isAsar: <const>false };
+      return notAsar;
     }
   }
 
-  if (!asarRe.test(archivePath)) return { isAsar: <const>false };
+  if (!mayBeInArchive(archivePath)) return notAsar;
 
-  if (!archives.isArchive(archivePath)) {
-    return { isAsar: false };
-  }
-
-  const res = asar.splitPath(path.normalize(archivePath));
-  if (false === res) {
-    throw new Error(`Invalid asar archive path: ${archivePath}`);
-  }
-  return res;
+  // One native call both checks the registered archives and splits the path.
+  return asar.splitArchivePath(path.normalize(archivePath)) || notAsar;
 };
\ No newline at end of file
@@ -6,7 +6,6 @@ import { Buffer } from 'buffer';
 import { Dirent, constants, Stats } from 'fs';
 import path from 'path';
 import util from 'util';
-import type * as Crypto from 'crypto';
 
 const Promise: PromiseConstructor = global.Promise;
 
@@ -16,7 +15,7 @@ const nextTick = (functionToCall: (...args: any[]) => any, args: any[] = []) =>
 const internalBinding = process.binding;
 const binding = internalBinding('fs');
 
-import { AsarFileInfo, FileType, AsarFileStat } from '../addon';
+import { AsarFileInfo, FileType, ArchiveBinding, WalkResult, indexedModuleStat } from '../addon';
 import {
   validateFunction, getOptions, getValidatedPath, getDirent, validateBoolean, assignFunctionName,
   isRealpathMappingEnabled
@@ -30,6 +29,7 @@ const uid = process.getuid?.() ?? 0;
 const gid = process.getgid?.() ?? 0;
 
 const fakeTime = new Date();
+const fakeTimeMs = fakeTime.getTime();
 
 function getDirents(p: string, { 0: names, 1: types }: any[][]): Dirent[] {
   for (let i = 0; i < names.length; i++) {
@@ -38,9 +38,9 @@ function getDirents(p: string, { 0: names, 1: types }: any[][]): Dirent[] {
     if (info.isAsar) {
       const archive = getOrCreateArchive(info.asarPath);
       if (!archive) continue;
-      const stats = archive.stat(info.filePath);
-      if (!stats) continue;
-      type = stats.type;
+      const fileType = archive.statType(info.filePath);
+      if (!fileType) continue;
+      type = fileType;
     }
     names[i] = getDirent(p, names[i], type);
   }
@@ -48,15 +48,31 @@ function getDirents(p: string, { 0: names, 1: types }: any[][]): Dirent[] {
   return names;
 }
 
+const entriesToDirents = function ({ names, types }: { names: string[], types: Uint8Array }) {
+  const dirents: Dirent[] = new Array(names.length);
+  for (let i = 0; i < names.length; i++) {
+    dirents[i] = new (Dirent as any)(names[i], types[i]);
+  }
+  return dirents;
+};
+
+// Read a directory of `archive` off the main thread, as dirents when `withFileTypes` is set.
+const readdirArchiveAsync = async function (archive: ArchiveBinding, filePath: string, withFileTypes?: boolean) {
+  if (!withFileTypes) return archive.readdirAsync(filePath);
+  const walkResult = await archive.walkAsync(filePath, { maxDepth: 1 }).catch(() => null);
+  if (!walkResult) return false;
+  return entriesToDirents({ names: walkResult.paths, types: walkResult.types });
+};
+
 const fileTypeToMode = new Map<FileType, number>([
   [FileType.kFile, constants.S_IFREG],
   [FileType.kDirectory, constants.S_IFDIR],
   [FileType.kLink, constants.S_IFLNK]
 ]);
 
-const asarStatsToFsStats = function (stats: AsarFileStat) {
+const asarTypeToFsStats = function (type: FileType, size: number) {
   const mode = constants.S_IROTH | constants.S_IRGRP | constants.S_IRUSR
-    | constants.S_IWUSR | fileTypeToMode.get(stats.type)!;
+    | constants.S_IWUSR | fileTypeToMode.get(type)!;
 
   return new (Stats as any)(
     1, // dev
@@ -67,15 +83,25 @@ const asarStatsToFsStats = function (stats: AsarFileStat) {
     0, // rdev
     undefined, // blksize
     ++nextInode, // ino
-    stats.size,
+    size,
     undefined, // blocks,
-    fakeTime.getTime(), // atim_msec
-    fakeTime.getTime(), // mtim_msec
-    fakeTime.getTime(), // ctim_msec
-    fakeTime.getTime() // birthtim_msec
+    fakeTimeMs, // atim_msec
+    fakeTimeMs, // mtim_msec
+    fakeTimeMs, // ctim_msec
+    fakeTimeMs // birthtim_msec
   );
 };
 
+// Shared with `Archive.statInto`, like node's own statValues: [size, offset].
+const statValues = new Float64Array(2);
+
+// Stat `filePath` of `archive` into a fs Stats object, or null if it does not exist.
+const statArchiveFile = function (archive: ArchiveBinding, filePath: string) {
+  const type = archive.statInto(filePath, statValues);
+  if (!type) return null;
+  return asarTypeToFsStats(type, statValues[0]);
+};
+
 const enum AsarError {
   NOT_FOUND = 'NOT_FOUND',
   NOT_DIR = 'NOT_DIR',
@@ -113,22 +139,98 @@ const createError = (errorType: AsarError, { asarPath, filePath }: { asarPath?:
   return error;
 };
 
-let crypto: typeof Crypto;
-function validateBufferIntegrity(buffer: Buffer, integrity: AsarFileInfo['integrity']) {
+function validateBufferIntegrity(
+  archive: ArchiveBinding, filePath: string, buffer: Buffer, integrity: AsarFileInfo['integrity']) {
   if (!integrity) return;
 
-  // Delay load crypto to improve app boot performance
-  // when integrity protection is not enabled
-  // eslint-disable-next-line @typescript-eslint/no-require-imports
-  crypto = crypto || require('crypto');
-  const actual = crypto.createHash(integrity.algorithm).update(buffer).digest('hex');
-  if (actual !== integrity.hash) {
-    console.error(`ASAR Integrity Violation: got a hash mismatch (${actual} vs ${integrity.hash})`);
+  // Files validated before are skipped natively.
+  if (!archive.validateIntegrity(filePath, buffer)) {
+    console.error(`ASAR Integrity Violation: got a hash mismatch for ${filePath} (expected ${integrity.hash})`);
     process.exit(1);
   }
 }
 
-const makePromiseFunction = function (orig: (...args: any[]) => any, pathArgumentIndex: number) {
+// Run a native read that throws on integrity violations, which are fatal
+// just like in validateBufferIntegrity. Other errors are thrown on.
+function readFailClosed<T>(read: () => T): T {
+  try {
+    return read();
+  } catch (error) {
+    if (!String((error as Error)?.message).startsWith('ASAR Integrity Violation')) throw error;
+    console.error((error as Error).message);
+    process.exit(1);
+  }
+}
+
+// Read a packed file natively, integrity blocks are validated in parallel
+// with reading the file.
+function readValidatedBuffer(archive: ArchiveBinding, filePath: string) {
+  return readFailClosed(() => archive.read(filePath));
+}
+
+// How long a file extracted for an API that needs a real file stays pinned, so
+// that `fileOutLimits` never evicts it while in use.
+const enum FileOutPin {
+  // Until the call returns or calls back.
+  Call,
+  // Until the fd or FileHandle opened on it is closed.
+  Fd,
+  // For as long as the binding lives, e.g. for loaded addons.
+  Binding,
+}
+
+// Files pinned for as long as their binding lives, by binding and path inside the archive.
+const pinnedFileOuts = new WeakMap<ArchiveBinding, Map<string, string>>();
+
+// Files pinned by the fds opened on them, released by the wrapped close and closeSync.
+const fdFileOuts = new Map<number, { archive: ArchiveBinding, filePath: string }>();
+
+// Extract `filePath` and pin it, see FileOutPin. Unless pinned by the binding, the
+// caller releases it, or hands it over to the opened fd with `pinFileOut`.
+const acquireFileOut = function (archive: ArchiveBinding, filePath: string, pin: FileOutPin) {
+  const newPath = archive.acquireFileOut(filePath);
+  if (!newPath || pin !== FileOutPin.Binding) return newPath;
+
+  let pinned = pinnedFileOuts.get(archive);
+  if (!pinned) {
+    pinned = new Map();
+    pinnedFileOuts.set(archive, pinned);
+  }
+  if (pinned.get(filePath) === newPath) {
+    // Pinned by an earlier call, one handle is enough.
+    archive.releaseFileOut(filePath);
+  }
+  else {
+    pinned.set(filePath, newPath);
+  }
+  return newPath;
+};
+
+// Hand the pin of an extracted file over to what the call opened on it: an fd, released
+// when closed through fs, or a FileHandle, released when it closes.
+const pinFileOut = function (archive: ArchiveBinding, filePath: string, opened: any) {
+  if (typeof opened === 'number') {
+    fdFileOuts.set(opened, { archive, filePath });
+  }
+  else if (opened && typeof opened.once === 'function') {
+    opened.once('close', () => archive.releaseFileOut(filePath));
+  }
+  else {
+    archive.releaseFileOut(filePath);
+  }
+};
+
+// Take the pin of an fd being closed, it is released once the close is done so that the
+// file is not evicted while still open.
+const takeFdFileOut = function (fd: number) {
+  const pinned = fdFileOuts.get(fd);
+  if (!pinned) return null;
+  fdFileOuts.delete(fd);
+  return () => pinned.archive.releaseFileOut(pinned.filePath);
+};
+
+const makePromiseFunction = function (
+  orig: (...args: any[]) => any, pathArgumentIndex: number, pin: FileOutPin) {
   return function (this: any, ...args: any[]) {
     const pathArgument = args[pathArgumentIndex];
     const pathInfo = splitPath(pathArgument);
@@ -140,19 +242,29 @@ const makePromiseFunction = function (orig: (...args: any[]) => any, pathArgumen
       return Promise.reject(createError(AsarError.INVALID_ARCHIVE, { asarPath }));
     }
 
-    const newPath = archive.copyFileOut(filePath);
+    const newPath = acquireFileOut(archive, filePath, pin);
     if (!newPath) {
       return Promise.reject(createError(AsarError.NOT_FOUND, { asarPath, filePath }));
     }
 
     args[pathArgumentIndex] = newPath;
-    return orig.apply(this, args);
+    if (pin === FileOutPin.Binding) return orig.apply(this, args);
+    if (pin === FileOutPin.Fd) {
+      return Promise.resolve(orig.apply(this, args)).then((opened) => {
+        pinFileOut(archive, filePath, opened);
+        return opened;
+      }, (error) => {
+        archive.releaseFileOut(filePath);
+        throw error;
+      });
+    }
+    return Promise.resolve(orig.apply(this, args)).finally(() => archive.releaseFileOut(filePath));
   };
 };
 
 const overrideAPISync = function (
   module: Record<string, any>,
-  name: string, pathArgumentIndex?: number | null, fromAsync: boolean = false) {
+  name: string, pathArgumentIndex?: number | null, fromAsync: boolean = false, pin: FileOutPin = FileOutPin.Binding) {
   if (pathArgumentIndex == null) pathArgumentIndex = 0;
   const old = module[name];
   const func = function (this: any, ...args: any[]) {
@@ -164,11 +276,29 @@ const overrideAPISync = function (
     const archive = getOrCreateArchive(asarPath!);
     if (!archive) throw createError(AsarError.INVALID_ARCHIVE, { asarPath });
 
-    const newPath = archive.copyFileOut(filePath!);
+    const newPath = acquireFileOut(archive, filePath!, pin);
     if (!newPath) throw createError(AsarError.NOT_FOUND, { asarPath, filePath });
 
     args[pathArgumentIndex!] = newPath;
-    return old.apply(this, args);
+    if (pin === FileOutPin.Binding) return old.apply(this, args);
+    if (pin === FileOutPin.Fd) {
+      let opened;
+      try {
+        opened = old.apply(this, args);
+      }
+      catch (error) {
+        archive.releaseFileOut(filePath!);
+        throw error;
+      }
+      pinFileOut(archive, filePath!, opened);
+      return opened;
+    }
+    try {
+      return old.apply(this, args);
+    }
+    finally {
+      archive.releaseFileOut(filePath!);
+    }
   };
   if (fromAsync) {
     return func;
@@ -176,7 +306,8 @@ const overrideAPISync = function (
   module[name] = func;
 };
 
-const overrideAPI = function (module: Record<string, any>, name: string, pathArgumentIndex?: number | null) {
+const overrideAPI = function (
+  module: Record<string, any>, name: string, pathArgumentIndex?: number | null, pin: FileOutPin = FileOutPin.Binding) {
   if (pathArgumentIndex == null) pathArgumentIndex = 0;
   const old = module[name];
   module[name] = function (this: any, ...args: any[]) {
@@ -187,7 +318,7 @@ const overrideAPI = function (module: Record<string, any>, name: string, pathArg
 
     const callback = args[args.length - 1];
     if (typeof callback !== 'function') {
-      return overrideAPISync(module, name, pathArgumentIndex!, true)!.apply(this, args);
+      return overrideAPISync(module, name, pathArgumentIndex!, true, pin)!.apply(this, args);
     }
 
     const archive = getOrCreateArchive(asarPath!);
@@ -197,7 +328,7 @@ const overrideAPI = function (module: Record<string, any>, name: string, pathArg
       return;
     }
 
-    const newPath = archive.copyFileOut(filePath!);
+    const newPath = acquireFileOut(archive, filePath!, pin);
     if (!newPath) {
       const error = createError(AsarError.NOT_FOUND, { asarPath, filePath });
       nextTick(callback, [error]);
@@ -205,18 +336,31 @@ const overrideAPI = function (module: Record<string, any>, name: string, pathArg
     }
 
     args[pathArgumentIndex!] = newPath;
+    if (pin === FileOutPin.Call) {
+      args[args.length - 1] = function (this: any, ...results: any[]) {
+        archive.releaseFileOut(filePath!);
+        return callback.apply(this, results);
+      };
+    }
+    else if (pin === FileOutPin.Fd) {
+      args[args.length - 1] = function (this: any, error: any, ...results: any[]) {
+        if (error) archive.releaseFileOut(filePath!);
+        else pinFileOut(archive, filePath!, results[0]);
+        return callback.call(this, error, ...results);
+      };
+    }
     return old.apply(this, args);
   };
 
   if (old[util.promisify.custom]) {
     module[name][util.promisify.custom] = assignFunctionName(
       name,
-      makePromiseFunction(old[util.promisify.custom], pathArgumentIndex)
+      makePromiseFunction(old[util.promisify.custom], pathArgumentIndex, pin)
     );
   }
 
   if (module.promises && module.promises[name]) {
-    module.promises[name] = makePromiseFunction(module.promises[name], pathArgumentIndex);
+    module.promises[name] = makePromiseFunction(module.promises[name], pathArgumentIndex, pin);
   }
 };
 
@@ -249,15 +393,15 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
       return null;
     }
 
-    const stats = archive.stat(filePath);
-    if (!stats) {
+    const fsStats = statArchiveFile(archive, filePath);
+    if (!fsStats) {
       if (shouldThrowStatError(options)) {
         throw createError(AsarError.NOT_FOUND, { asarPath, filePath });
       };
       return null;
     }
 
-    return asarStatsToFsStats(stats);
+    return fsStats;
   };
 
   const { lstat } = fs;
@@ -277,15 +421,14 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
       return;
     }
 
-    const stats = archive.stat(filePath);
-    if (!stats) {
-      const error = createError(AsarError.NOT_FOUND, { asarPath, filePath });
-      nextTick(callback, [error]);
-      return;
-    }
-
-    const fsStats = asarStatsToFsStats(stats);
-    nextTick(callback, [null, fsStats]);
+    archive.statAsync(filePath).then((stats) => {
+      if (!stats) {
+        const error = createError(AsarError.NOT_FOUND, { asarPath, filePath });
+        nextTick(callback, [error]);
+        return;
+      }
+      nextTick(callback, [null, asarTypeToFsStats(stats.type, stats.size)]);
+    }, (error) => nextTick(callback, [error]));
   };
 
   fs.promises.lstat = util.promisify(fs.lstat);
@@ -385,21 +528,22 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
         return;
       }
 
-      const fileRealPath = archive.realpath(filePath!);
-      if (fileRealPath === false) {
-        const error = createError(AsarError.NOT_FOUND, { asarPath, filePath });
-        nextTick(callback, [error]);
-        return;
-      }
-
-      realpath(asarPath, options, (error: Error | null, archiveRealPath: string) => {
-        if (error === null) {
-          const fullPath = path.join(archiveRealPath, fileRealPath);
-          callback(null, fullPath);
-        } else {
-          callback(error);
+      archive.realpathAsync(filePath!).then((fileRealPath) => {
+        if (fileRealPath === false) {
+          const error = createError(AsarError.NOT_FOUND, { asarPath, filePath });
+          nextTick(callback, [error]);
+          return;
         }
-      });
+
+        realpath(asarPath, options, (error: Error | null, archiveRealPath: string) => {
+          if (error === null) {
+            const fullPath = path.join(archiveRealPath, fileRealPath);
+            callback(null, fullPath);
+          } else {
+            callback(error);
+          }
+        });
+      }, (error) => nextTick(callback, [error]));
     };
   };
 
@@ -428,7 +572,7 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
       return;
     }
 
-    const pathExists = (archive.stat(filePath) !== false);
+    const pathExists = (archive.statType(filePath) !== 0);
     nextTick(callback, [pathExists]);
   };
 
@@ -443,7 +587,7 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
       return Promise.reject(error);
     }
 
-    return Promise.resolve(archive.stat(filePath) !== false);
+    return Promise.resolve(archive.statType(filePath) !== 0);
   };
 
   const { existsSync } = fs;
@@ -460,7 +604,7 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
     const archive = getOrCreateArchive(asarPath);
     if (!archive) return false;
 
-    return !!archive.stat(filePath);
+    return archive.statType(filePath) !== 0;
   };
 
   const { access } = fs;
@@ -493,8 +637,7 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
       return fs.access(realPath, mode, callback);
     }
 
-    const stats = archive.stat(filePath);
-    if (!stats) {
+    if (!archive.statType(filePath)) {
       const error = createError(AsarError.NOT_FOUND, { asarPath, filePath });
       nextTick(callback, [error]);
       return;
@@ -543,8 +686,7 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
       return fs.accessSync(realPath, mode);
     }
 
-    const stats = archive.stat(filePath);
-    if (!stats) {
+    if (!archive.statType(filePath)) {
       throw createError(AsarError.NOT_FOUND, { asarPath, filePath });
     }
 
@@ -595,7 +737,7 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
       }
 
       const buffer = Buffer.alloc(info.size);
-      const fd = archive.getFdAndValidateIntegrityLater();
+      const fd = archive.getFdAndValidateIntegrityLater(filePath);
       if (!(fd >= 0)) {
         const error = createError(AsarError.NOT_FOUND, { asarPath, filePath });
         nextTick(callback, [error]);
@@ -604,7 +746,8 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
 
       logASARAccess(asarPath, filePath, info.offset);
       fs.read(fd, buffer, 0, info.size, info.offset, (error: Error) => {
-        validateBufferIntegrity(buffer, info.integrity);
+        archive.releaseFd(fd);
+        validateBufferIntegrity(archive, filePath, buffer, info.integrity);
         callback(error, encoding ? buffer.toString(encoding) : buffer);
       });
     }
@@ -658,15 +801,41 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
     }
 
     const { encoding } = options;
+    if (encoding === 'utf8' || encoding === 'utf-8') {
+      // Module sources land here, read them without an intermediate Buffer.
+      const source = readFailClosed(() => archive.readSource(filePath));
+      if (source !== false) {
+        logASARAccess(asarPath, filePath, info.offset);
+        return source;
+      }
+    }
+    if (encoding === 'utf8' || encoding === 'utf-8' || encoding === 'latin1' || encoding === 'binary') {
+      logASARAccess(asarPath, filePath, info.offset);
+      const text = readFailClosed(() => archive.read(filePath, 0, info.size, encoding));
+      if (text === false) throw createError(AsarError.NOT_FOUND, { asarPath, filePath });
+      return text;
+    }
+
+    if (info.integrity) {
+      logASARAccess(asarPath, filePath, info.offset);
+      const buffer = readValidatedBuffer(archive, filePath);
+      if (!buffer) throw createError(AsarError.NOT_FOUND, { asarPath, filePath });
+      return (encoding) ? buffer.toString(encoding) : buffer;
+    }
+
     const buffer = Buffer.alloc(info.size);
-    const fd = archive.getFdAndValidateIntegrityLater();
+    const fd = archive.getFdAndValidateIntegrityLater(filePath);
     if (!(fd >= 0)) {
       throw createError(AsarError.NOT_FOUND, { asarPath, filePath });
     }
 
     logASARAccess(asarPath, filePath, info.offset);
-    fs.readSync(fd, buffer, 0, info.size, info.offset);
-    validateBufferIntegrity(buffer, info.integrity);
+    try {
+      fs.readSync(fd, buffer, 0, info.size, info.offset);
+    } finally {
+      archive.releaseFd(fd);
+    }
+    validateBufferIntegrity(archive, filePath, buffer, info.integrity);
     return (encoding) ? buffer.toString(encoding) : buffer;
   }
 
@@ -692,9 +861,9 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
       if (info.isAsar) {
         const archive = getOrCreateArchive(info.asarPath);
         if (!archive) return;
-        const stats = archive.stat(info.filePath);
-        if (!stats) continue;
-        type = stats.type;
+        const fileType = archive.statType(info.filePath);
+        if (!fileType) continue;
+        type = fileType;
       }
 
       const dirent = getDirent(currentPath, result[0][i], type)!;
@@ -722,6 +891,21 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
   const processReaddirResult = (args: any) => (args.context.withFileTypes
     ? handleDirents(args) : handleFilePaths(args));
 
+  // Append the whole tree below the archive directory `dirPath`, walked natively
+  // in one call, to the results of a recursive readdir.
+  function appendWalkResult(context: any, dirPath: string, { paths, types }: WalkResult) {
+    const prefix = path.relative(context.basePath, dirPath);
+    for (let i = 0; i < paths.length; i++) {
+      if (context.withFileTypes) {
+        const fullPath = path.join(dirPath, paths[i]);
+        context.readdirResults.push(getDirent(path.dirname(fullPath), path.basename(fullPath), types[i]));
+      }
+      else {
+        context.readdirResults.push(prefix ? path.join(prefix, paths[i]) : paths[i]);
+      }
+    }
+  }
+
   function readdirRecursive(basePath: string, options: ReaddirOptions, callback: ReaddirCallback) {
     const context = {
       withFileTypes: Boolean(options!.withFileTypes),
@@ -761,7 +945,6 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
 
       const pathInfo = splitPath(pathArg);
       if (pathInfo.isAsar) {
-        let readdirResult: string[] | false | [string[], Stats[]];
         const { asarPath, filePath } = pathInfo;
 
         const archive = getOrCreateArchive(asarPath);
@@ -771,34 +954,19 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
           return;
         }
 
-        readdirResult = archive.readdir(filePath);
-        if (!readdirResult) {
+        archive.walkAsync(filePath).then((walkResult) => {
+          nextTick(() => {
+            appendWalkResult(context, pathArg, walkResult);
+            if (i < context.pathsQueue.length) {
+              read(context.pathsQueue[i++]);
+            } else {
+              callback(null, context.readdirResults);
+            }
+          });
+        }, () => {
           const error = createError(AsarError.NOT_FOUND, { asarPath, filePath });
           nextTick(callback, [error]);
-          return;
-        }
-
-        // If we're in an asar dir, we need to ensure the result is in the same format as the
-        // native call to readdir withFileTypes i.e. an array of arrays.
-        if (context.withFileTypes) {
-          readdirResult = [
-            [...readdirResult], readdirResult.map((p: string) => {
-              return internalBinding('fs').internalModuleStat(path.join(pathArg, p));
-            })
-          ];
-        }
-
-        processReaddirResult({
-          result: readdirResult,
-          currentPath: pathArg,
-          context
         });
-
-        if (i < context.pathsQueue.length) {
-          read(context.pathsQueue[i++]);
-        } else {
-          callback(null, context.readdirResults);
-        }
       } else {
         binding.readdir(
           pathArg,
@@ -814,76 +982,58 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
   const { kUsePromises } = binding;
   async function readdirRecursivePromises(originalPath: string, options: ReaddirOptions) {
     const result: any[] = [];
-
-    const pathInfo = splitPath(originalPath);
-    let queue: [string, string[]][] = [];
     const withFileTypes = Boolean(options?.withFileTypes);
+    const context = { basePath: originalPath, withFileTypes, readdirResults: result };
+
+    // Archive directories are walked natively as a whole.
+    const walkArchiveDir = async (dirPath: string, info: { asarPath: string, filePath: string }) => {
+      const archive = getOrCreateArchive(info.asarPath);
+      if (!archive) return false;
+      const walkResult = await archive.walkAsync(info.filePath).catch(() => null);
+      if (!walkResult) return false;
+      appendWalkResult(context, dirPath, walkResult);
+      return true;
+    };
 
-    let initialItem: any[] = [];
+    const pathInfo = splitPath(originalPath);
     if (pathInfo.isAsar) {
-      const archive = getOrCreateArchive(pathInfo.asarPath);
-      if (!archive) return result;
-      const files = archive.readdir(pathInfo.filePath);
-      if (!files) return result;
-
-      // If we're in an asar dir, we need to ensure the result is in the same format as the
-      // native call to readdir withFileTypes i.e. an array of arrays.
-      initialItem = files;
-      if (withFileTypes) {
-        initialItem = [
-          [...initialItem], initialItem.map((p: string) => {
-            return internalBinding('fs').internalModuleStat(path.join(originalPath, p));
-          })
-        ];
-      }
-    } else {
-      initialItem = await binding.readdir(
-        path.toNamespacedPath(originalPath),
-        options!.encoding,
-        withFileTypes,
-        kUsePromises
-      );
+      await walkArchiveDir(originalPath, pathInfo);
+      return result;
     }
 
-    queue = [[originalPath, initialItem]];
+    const initialItem = await binding.readdir(
+      path.toNamespacedPath(originalPath),
+      options!.encoding,
+      withFileTypes,
+      kUsePromises
+    );
+    const queue: [string, any[]][] = [[originalPath, initialItem]];
 
     if (withFileTypes) {
       while (queue.length > 0) {
-        // @ts-expect-error this is a valid array destructure assignment.
-        const { 0: pathArg, 1: readDir } = queue.pop();
+        const { 0: pathArg, 1: readDir } = queue.pop()!;
         for (const dirent of getDirents(pathArg, readDir)) {
           result.push(dirent);
           if (dirent.isDirectory()) {
             const direntPath = path.join(pathArg, dirent.name);
             const info = splitPath(direntPath);
-            let readdirResult;
             if (info.isAsar) {
-              const archive = getOrCreateArchive(info.asarPath);
-              if (!archive) continue;
-              const files = archive.readdir(info.filePath);
-              if (!files) continue;
-
-              readdirResult = [
-                [...files], files.map((p: string) => {
-                  return internalBinding('fs').internalModuleStat(path.join(direntPath, p));
-                })
-              ];
-            } else {
-              readdirResult = await binding.readdir(
-                direntPath,
-                options!.encoding,
-                true,
-                kUsePromises
-              );
+              await walkArchiveDir(direntPath, info);
+              continue;
             }
+            const readdirResult = await binding.readdir(
+              direntPath,
+              options!.encoding,
+              true,
+              kUsePromises
+            );
             queue.push([direntPath, readdirResult]);
           }
         }
       }
     } else {
       while (queue.length > 0) {
-        // @ts-expect-error this is a valid array destructure assignment.
-        const { 0: pathArg, 1: readDir } = queue.pop();
+        const { 0: pathArg, 1: readDir } = queue.pop()!;
         for (const ent of readDir) {
           const direntPath = path.join(pathArg, ent);
           const stat = internalBinding('fs').internalModuleStat(direntPath);
@@ -891,21 +1041,16 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
 
           if (stat === 1) {
             const subPathInfo = splitPath(direntPath);
-            let item: string[] = [];
             if (subPathInfo.isAsar) {
-              const archive = getOrCreateArchive(subPathInfo.asarPath);
-              if (!archive) return;
-              const files = archive.readdir(subPathInfo.filePath);
-              if (!files) return result;
-              item = files;
-            } else {
-              item = await binding.readdir(
-                path.toNamespacedPath(direntPath),
-                options!.encoding,
-                false,
-                kUsePromises
-              );
+              if (!await walkArchiveDir(direntPath, subPathInfo)) return result;
+              continue;
             }
+            const item = await binding.readdir(
+              path.toNamespacedPath(direntPath),
+              options!.encoding,
+              false,
+              kUsePromises
+            );
             queue.push([direntPath, item]);
           }
         }
@@ -933,17 +1078,10 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
         const archive = getOrCreateArchive(asarPath);
         if (!archive) return;
 
-        readdirResult = archive.readdir(filePath);
-        if (!readdirResult) return;
-        // If we're in an asar dir, we need to ensure the result is in the same format as the
-        // native call to readdir withFileTypes i.e. an array of arrays.
-        if (context.withFileTypes) {
-          readdirResult = [
-            [...readdirResult], readdirResult.map((p: string) => {
-              return internalBinding('fs').internalModuleStat(path.join(pathArg, p));
-            })
-          ];
-        }
+        const walkResult = archive.walk(filePath);
+        if (!walkResult) return;
+        appendWalkResult(context, pathArg, walkResult);
+        return;
       } else {
         readdirResult = binding.readdir(
           path.toNamespacedPath(pathArg),
@@ -998,30 +1136,14 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
       return;
     }
 
-    const files = archive.readdir(filePath);
-    if (!files) {
-      const error = createError(AsarError.NOT_FOUND, { asarPath, filePath });
-      nextTick(callback!, [error]);
-      return;
-    }
-
-    if (options?.withFileTypes) {
-      const dirents: string[] = [];
-      for (const file of files) {
-        const childPath = path.join(filePath, file);
-        const stats = archive.stat(childPath);
-        if (!stats) {
-          const error = createError(AsarError.NOT_FOUND, { asarPath, filePath: childPath });
-          nextTick(callback!, [error]);
-          return;
-        }
-        dirents.push(new fs.Dirent(file, stats.type));
+    readdirArchiveAsync(archive, filePath, options?.withFileTypes).then((files) => {
+      if (!files) {
+        const error = createError(AsarError.NOT_FOUND, { asarPath, filePath });
+        nextTick(callback!, [error]);
+        return;
       }
-      nextTick(callback!, [null, dirents]);
-      return;
-    }
-
-    nextTick(callback!, [null, files]);
+      nextTick(callback!, [null, files]);
+    }, (error) => nextTick(callback!, [error]));
   };
 
   const { readdir: readdirPromise } = fs.promises;
@@ -1046,25 +1168,12 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
       return Promise.reject(createError(AsarError.INVALID_ARCHIVE, { asarPath }));
     }
 
-    const files = archive.readdir(filePath);
+    const files = await readdirArchiveAsync(archive, filePath, options?.withFileTypes);
     if (!files) {
-      return Promise.reject(createError(AsarError.NOT_FOUND, { asarPath, filePath }));
-    }
-
-    if (options?.withFileTypes) {
-      const dirents: string[] = [];
-      for (const file of files) {
-        const childPath = path.join(filePath, file);
-        const stats = archive.stat(childPath);
-        if (!stats) {
-          throw createError(AsarError.NOT_FOUND, { asarPath, filePath: childPath });
-        }
-        dirents.push(new fs.Dirent(file, stats.type));
-      }
-      return Promise.resolve(dirents);
+      throw createError(AsarError.NOT_FOUND, { asarPath, filePath });
     }
 
-    return Promise.resolve(files);
+    return files;
   };
 
   const { readdirSync } = fs;
@@ -1089,29 +1198,29 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
       throw createError(AsarError.INVALID_ARCHIVE, { asarPath });
     }
 
+    if (options?.withFileTypes) {
+      const entries = archive.readdirWithTypes(filePath);
+      if (!entries) {
+        throw createError(AsarError.NOT_FOUND, { asarPath, filePath });
+      }
+      return entriesToDirents(entries);
+    }
+
     const files = archive.readdir(filePath);
     if (!files) {
       throw createError(AsarError.NOT_FOUND, { asarPath, filePath });
     }
 
-    if (options?.withFileTypes) {
-      const dirents: string[] = [];
-      for (const file of files) {
-        const childPath = path.join(filePath, file);
-        const stats = archive.stat(childPath);
-        if (!stats) {
-          throw createError(AsarError.NOT_FOUND, { asarPath, filePath: childPath });
-        }
-        dirents.push(new fs.Dirent(file, stats.type));
-      }
-      return dirents;
-    }
-
     return files;
   };
 
   const { internalModuleStat } = binding;
   internalBinding('fs').internalModuleStat = (pathArgument: string) => {
+    if (archives._pathIndexEnabled) {
+      const stat = indexedModuleStat(pathArgument);
+      if (stat !== false) return stat;
+    }
+
     const pathInfo = splitPath(pathArgument);
     if (!pathInfo.isAsar) return internalModuleStat(pathArgument);
     const { asarPath, filePath } = pathInfo;
@@ -1121,10 +1230,10 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
     if (!archive) return -34;
 
     // -ENOENT
-    const stats = archive.stat(filePath);
-    if (!stats) return -34;
+    const fileType = archive.statType(filePath);
+    if (!fileType) return -34;
 
-    return (stats.type === FileType.kDirectory) ? 1 : 0;
+    return (fileType === FileType.kDirectory) ? 1 : 0;
   };
 
 
@@ -1162,14 +1271,36 @@ export const wrapFsWithAsar = (fs: Record<string, any>) => {
   const Module = require('module') as NodeJS.ModuleInternal;
   // Strictly implementing the flags of fs.copyFile is hard, just do a simple
   // implementation for now. Doing 2 copies won't spend much time more as OS
-  // has filesystem caching.
-  overrideAPI(fs, 'copyFile');
-  overrideAPISync(fs, 'copyFileSync');
+  // has filesystem caching. The extracted file is only pinned during the copy.
+  overrideAPI(fs, 'copyFile', 0, FileOutPin.Call);
+  overrideAPISync(fs, 'copyFileSync', 0, false, FileOutPin.Call);
 
-  overrideAPI(fs, 'open');
+  // Opened files stay pinned until closed, loaded addons for good.
+  overrideAPI(fs, 'open', 0, FileOutPin.Fd);
   overrideAPISync(process, 'dlopen', 1);
   overrideAPISync(Module._extensions, '.node', 1);
-  overrideAPISync(fs, 'openSync');
+  overrideAPISync(fs, 'openSync', 0, false, FileOutPin.Fd);
+
+  const { close } = fs;
+  fs.close = function (this: any, fd: number, callback?: (error: NodeJS.ErrnoException | null) => void) {
+    const release = takeFdFileOut(fd);
+    if (!release) return close.apply(this, arguments as any);
+    close.call(this, fd, (error: NodeJS.ErrnoException | null) => {
+      release();
+      if (typeof callback === 'function') callback(error);
+    });
+  };
+
+  const { closeSync } = fs;
+  fs.closeSync = function (this: any, fd: number) {
+    const release = takeFdFileOut(fd);
+    try {
+      return closeSync.apply(this, arguments as any);
+    }
+    finally {
+      if (release) release();
+    }
+  };
 
   return fs;
 };
@@ -0,0 +1,29 @@
+// Compare wrapped fs.statSync against the original one.
+// Usage: npm run build && npm run build:test && node test/bench-stat.js
+const path = require('path');
+const fs = require('fs');
+const asar = require('../');
+
+const iterations = Number(process.argv[2]) || 200000;
+const nativeStatSync = fs.statSync;
+const nonAsarPath = __filename;
+const asarPath = path.resolve(__dirname, 'fixtures/app.asar/package.json');
+
+asar.register({
+    archives: [path.resolve(__dirname, 'fixtures/app.asar')],
+});
+
+function bench(name, fn) {
+    // Warm up so that both variants are measured optimized.
+    for (let i = 0; i < iterations / 10; i++) fn();
+    const start = process.hrtime.bigint();
+    for (let i = 0; i < iterations; i++) fn();
+    const ns = Number(process.hrtime.bigint() - start) / iterations;
+    console.log(`${name}: ${ns.toFixed(1)} ns/op`);
+    return ns;
+}
+
+const base = bench('original statSync, non-asar', () => nativeStatSync(nonAsarPath));
+const wrapped = bench('wrapped statSync, non-asar', () => fs.statSync(nonAsarPath));
+bench('wrapped statSync, asar', () => fs.statSync(asarPath));
+console.log(`non-asar overhead: ${((wrapped / base - 1) * 100).toFixed(1)}%`);
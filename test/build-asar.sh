@@ -9,4 +9,9 @@ if [ ! -f ./fixtures/app.asar ]; then
     ln -s index.js index-link.js
     cd $baseDir/fixtures/asar-source && $baseDir/../node_modules/.bin/asar pack app ../app.asar
     echo 'pack app.asar done'
-fi
\ No newline at end of file
+fi
+
+if [ ! -f $baseDir/fixtures/patch.asar ]; then
+    cd $baseDir/fixtures/asar-source && $baseDir/../node_modules/.bin/asar pack patch ../patch.asar
+    echo 'pack patch.asar done'
+fi
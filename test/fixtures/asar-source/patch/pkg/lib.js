@@ -0,0 +1 @@
+exports.patched = true;
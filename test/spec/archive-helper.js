@@ -0,0 +1,31 @@
+const crypto = require('crypto');
+const fs = require('fs');
+
+const sha256 = (data) => crypto.createHash('sha256').update(data).digest('hex');
+
+/**
+ * Writes an archive with the JSON header `{files}` followed by `payload`,
+ * for archives that `asar pack` would never write.
+ */
+exports.writeArchive = (file, files, payload = Buffer.alloc(0)) => {
+    const json = Buffer.from(JSON.stringify({ files }));
+    const padding = (4 - json.length % 4) % 4;
+    const header = Buffer.alloc(16 + json.length + padding);
+    header.writeUInt32LE(4, 0);
+    header.writeUInt32LE(8 + json.length + padding, 4);
+    header.writeUInt32LE(4 + json.length + padding, 8);
+    header.writeUInt32LE(json.length, 12);
+    json.copy(header, 16);
+    fs.writeFileSync(file, Buffer.concat([header, payload]));
+};
+
+/**
+ * The integrity of `content` the way `@electron/asar` writes it.
+ */
+exports.integrityOf = (content, blockSize = 4 * 1024 * 1024) => {
+    const blocks = [];
+    for (let i = 0; i === 0 || i < content.length; i += blockSize) {
+        blocks.push(sha256(content.subarray(i, i + blockSize)));
+    }
+    return { algorithm: 'SHA256', hash: sha256(content), blockSize, blocks };
+};
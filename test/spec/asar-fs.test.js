@@ -2,6 +2,7 @@
 const path = require('path');
 const assert = require('assert');
 const asar = require('./node-asar-addon');
+const { writeArchive } = require('./archive-helper');
 
 /**
  * @type {import('fs')}
@@ -428,5 +429,406 @@ describe('asar archive', () => {
                 assert.ok(err.code === 'ENOENT', 'promises.access should throw ENOENT for nonexistent file');
             }
         });
+        it('archive extension in any case', function () {
+            const archivePath = '/tmp/node-asar-addon/Upper.ASAR';
+            fs.copyFileSync(path.resolve(fixturesDir, 'app.asar'), archivePath);
+            asar.archives.loadArchives({ archives: [archivePath], mirrorAsarBasePath: false });
+            assert.ok(asar.archives.isArchive(archivePath), 'archive should be registered');
+            const json = JSON.parse(fs.readFileSync(archivePath + '/package.json', 'utf8'));
+            assert.ok(json.version === '1.0.0', 'readFileSync should work inside an upper case archive');
+            assert.ok(fs.statSync(archivePath + '/pkg/').isDirectory(), 'statSync should work with a trailing separator');
+        });
+        it('archive without .asar extension', function () {
+            for (const name of ['app-noext', 'app.pak']) {
+                const archivePath = path.join('/tmp/node-asar-addon', name);
+                fs.copyFileSync(path.resolve(fixturesDir, 'app.asar'), archivePath);
+                asar.archives.loadArchives({ archives: [archivePath], mirrorAsarBasePath: false });
+                assert.ok(!asar.archives.isArchive(archivePath), `${name} should not be registered`);
+                assert.ok(!fs.existsSync(archivePath + '/package.json'), `${name} should not be read as an archive`);
+                assert.ok(fs.statSync(archivePath).isFile(), `${name} should stay a plain file`);
+            }
+        });
+    });
+
+    describe('archive api', () => {
+        it('extractTree', function () {
+            const archive = asar.getOrCreateArchive(path.resolve(fixturesDir, 'app.asar'));
+            const destDir = '/tmp/node-asar-addon/extract-pkg';
+            const result = archive.extractTree('pkg', destDir, { concurrency: 2 });
+            assert.ok(result.files > 0, 'extractTree should extract files');
+            assert.ok(result.bytes > 0 && result.bytesPerSecond >= 0, 'extractTree should report throughput');
+            assert.strictEqual(
+                fs.readFileSync(path.join(destDir, 'lib.js'), 'utf8'),
+                fs.readFileSync(path.resolve(fixturesDir, 'app.asar/pkg/lib.js'), 'utf8'),
+                'extracted file should match the archive content'
+            );
+            assert.throws(() => archive.extractTree('package.json', destDir), 'extractTree should throw for files');
+        });
+        it('extractTreeAsync', async function () {
+            const archive = asar.getOrCreateArchive(path.resolve(fixturesDir, 'app.asar'));
+            const destDir = '/tmp/node-asar-addon/extract-pkg-async';
+            const result = await archive.extractTreeAsync('pkg', destDir, { concurrency: 2 });
+            assert.ok(result.files > 0, 'extractTreeAsync should extract files');
+            assert.strictEqual(
+                fs.readFileSync(path.join(destDir, 'lib.js'), 'utf8'),
+                fs.readFileSync(path.resolve(fixturesDir, 'app.asar/pkg/lib.js'), 'utf8'),
+                'extracted file should match the archive content'
+            );
+            await assert.rejects(archive.extractTreeAsync('package.json', destDir), 'extractTreeAsync should reject for files');
+            fs.writeFileSync('/tmp/node-asar-addon/extract-file', '');
+            await assert.rejects(archive.extractTreeAsync('pkg', '/tmp/node-asar-addon/extract-file/sub'), /Failed to create directory/, 'extractTreeAsync should reject when destDir cannot be created');
+        });
+        it('extractTree rejects paths out of destDir', function () {
+            const destDir = '/tmp/node-asar-addon/extract-unsafe';
+            const file = { size: 1, offset: '0' };
+            const unsafe = {
+                'dotdot': { '..': { files: { 'escaped.txt': file } } },
+                'name': { '../escaped.txt': file },
+                'absolute': { '/tmp/node-asar-addon/escaped.txt': file },
+                'link': { 'escaped.txt': { link: '../../etc/passwd' } },
+            };
+            for (const [name, files] of Object.entries(unsafe)) {
+                const archivePath = `/tmp/node-asar-addon/${name}.asar`;
+                writeArchive(archivePath, files, Buffer.from('x'));
+                assert.throws(() => asar.getOrCreateArchive(archivePath).extractTree('', destDir), /Unsafe/, `extractTree should reject ${name}`);
+            }
+            assert.ok(!fs.existsSync('/tmp/node-asar-addon/escaped.txt'), 'nothing should be written out of destDir');
+            writeArchive('/tmp/node-asar-addon/sub-link.asar', { 'top.txt': file, sub: { files: { 'l': { link: 'top.txt' } } } }, Buffer.from('x'));
+            assert.throws(() => asar.getOrCreateArchive('/tmp/node-asar-addon/sub-link.asar').extractTree('sub', destDir), /Unsafe/, 'links out of the extracted directory should be rejected');
+        });
+        it('read', function () {
+            const archive = asar.getOrCreateArchive(path.resolve(fixturesDir, 'app.asar'));
+            const content = fs.readFileSync(path.resolve(fixturesDir, 'app.asar/package.json'));
+            assert.ok(archive.read('package.json').equals(content), 'read should return the whole file');
+            assert.ok(archive.read('package.json', 2, 10).equals(content.subarray(2, 12)), 'read should return a range');
+            assert.strictEqual(archive.read('package.json', 0, undefined, 'utf8'), content.toString('utf8'), 'read should decode utf8');
+            assert.strictEqual(archive.read('package.json', 2, 10, 'latin1'), content.toString('latin1', 2, 12), 'read should decode latin1');
+            assert.strictEqual(archive.read('nonexistent.json'), false, 'read should return false for nonexistent file');
+        });
+        it('unload', function () {
+            const archivePath = path.resolve(fixturesDir, 'app.asar');
+            fs.readFileSync(path.join(archivePath, 'package.json'));
+            const before = asar.archives.getMemoryStats().archives.find((usage) => usage.path === archivePath);
+            assert.ok(before && before.headerBytes > 0, 'memory stats should list the opened archive');
+            const usage = asar.archives.unload(archivePath);
+            assert.strictEqual(usage && usage.headerBytes, before.headerBytes, 'unload should report the released memory');
+            assert.ok(!asar.archives.getMemoryStats().archives.some((usage) => usage.path === archivePath), 'unloaded archive should not be listed');
+            assert.strictEqual(asar.archives.unload(archivePath), false, 'unload should return false for archives not opened');
+            assert.ok(fs.existsSync(path.join(archivePath, 'package.json')), 'unloaded archive should open again on access');
+        });
+        it('overlay', function () {
+            const archivePath = path.resolve(fixturesDir, 'app.asar');
+            asar.archives.setOverlay(archivePath, [path.resolve(fixturesDir, 'patch.asar')]);
+            try {
+                assert.strictEqual(fs.readFileSync(path.join(archivePath, 'pkg/lib.js'), 'utf8'), 'exports.patched = true;\n', 'upper layer should shadow the file');
+                assert.ok(fs.existsSync(path.join(archivePath, 'pkg/package.json')), 'lower layer files should stay visible');
+                assert.ok(!fs.existsSync(path.join(archivePath, 'dep.js')), 'whiteout should hide the file');
+                assert.ok(!fs.readdirSync(archivePath).includes('.wh.dep.js'), 'whiteouts should not be listed');
+            } finally {
+                asar.archives.setOverlay(archivePath, []);
+            }
+            assert.ok(fs.existsSync(path.join(archivePath, 'dep.js')), 'removing the overlay should restore the file');
+        });
+        it('readSource', function () {
+            const archive = asar.getOrCreateArchive(path.resolve(fixturesDir, 'app.asar'));
+            const content = fs.readFileSync(path.resolve(fixturesDir, 'app.asar/pkg/lib.js'));
+            assert.strictEqual(archive.readSource('pkg/lib.js'), content.toString('utf8'), 'readSource should decode the file');
+            assert.strictEqual(archive.readSource('pkg'), false, 'readSource should return false for directories');
+            assert.strictEqual(fs.readFileSync(path.resolve(fixturesDir, 'app.asar/pkg/lib.js'), 'utf8'), content.toString('utf8'), 'readFileSync with utf8 should return the same source');
+        });
+        it('readSource keeps its content when the archive changes', function () {
+            const archivePath = '/tmp/node-asar-addon/source.asar';
+            const ascii = Buffer.from('module.exports = 1;\n');
+            const utf8 = Buffer.from('module.exports = "h\u00e9llo \u{1F600}";\n');
+            writeArchive(archivePath, {
+                'ascii.js': { size: ascii.length, offset: '0' },
+                'utf8.js': { size: utf8.length, offset: String(ascii.length) },
+                'empty.js': { size: 0, offset: '0' },
+            }, Buffer.concat([ascii, utf8]));
+            const archive = asar.getOrCreateArchive(archivePath);
+            const asciiSource = archive.readSource('ascii.js');
+            const utf8Source = archive.readSource('utf8.js');
+            assert.strictEqual(asciiSource, ascii.toString('utf8'), 'readSource should return ASCII sources');
+            assert.strictEqual(utf8Source, utf8.toString('utf8'), 'readSource should decode UTF-8 sources');
+            assert.strictEqual(archive.readSource('empty.js'), '', 'readSource should return empty sources');
+            assert.strictEqual(archive.readSource('missing.js'), false, 'readSource should return false for missing files');
+
+            // The strings own their content, truncating the archive must not reach them.
+            fs.truncateSync(archivePath, 0);
+            assert.strictEqual(asciiSource, ascii.toString('utf8'), 'ASCII sources should not change with the archive');
+            assert.strictEqual(utf8Source, utf8.toString('utf8'), 'UTF-8 sources should not change with the archive');
+            assert.strictEqual(archive.readSource('ascii.js'), false, 'reads past the end of a truncated archive should fail');
+        });
+        it('mapEntry', function () {
+            const archive = asar.getOrCreateArchive(path.resolve(fixturesDir, 'app.asar'));
+            const content = fs.readFileSync(path.resolve(fixturesDir, 'app.asar/pkg/lib.js'));
+            const mapped = archive.mapEntry('pkg/lib.js');
+            assert.ok(mapped instanceof ArrayBuffer, 'mapEntry should return an ArrayBuffer');
+            assert.ok(Buffer.from(mapped).equals(content), 'mapEntry should map the file content');
+            new Uint8Array(mapped)[0] = 0;
+            assert.strictEqual(archive.readSource('pkg/lib.js'), content.toString('utf8'), 'writes to the mapping should stay private');
+            assert.strictEqual(archive.mapEntry('pkg'), false, 'mapEntry should return false for directories');
+        });
+        it('statInto', function () {
+            const archive = asar.getOrCreateArchive(path.resolve(fixturesDir, 'app.asar'));
+            const values = new Float64Array(2);
+            const stat = archive.stat('package.json');
+            assert.strictEqual(archive.statInto('package.json', values), stat.type, 'statInto should return the type');
+            assert.deepStrictEqual(Array.from(values), [stat.size, stat.offset], 'statInto should write size and offset');
+            assert.strictEqual(archive.statInto('nonexistent.json', values), 0, 'statInto should return 0 for nonexistent file');
+            assert.strictEqual(archive.statType('pkg'), 2, 'statType should return the directory type');
+        });
+        it('readdirWithTypes', function () {
+            const archive = asar.getOrCreateArchive(path.resolve(fixturesDir, 'app.asar'));
+            const { names, types } = archive.readdirWithTypes('');
+            assert.deepStrictEqual(names, archive.readdir(''), 'readdirWithTypes should list the same names');
+            assert.ok(types instanceof Uint8Array && types.length === names.length, 'readdirWithTypes should return types');
+            names.forEach((name, i) => assert.strictEqual(types[i], archive.statType(name), `type of ${name} should match statType`));
+            assert.strictEqual(archive.readdirWithTypes('package.json'), false, 'readdirWithTypes should return false for files');
+        });
+        it('walk', async function () {
+            const archive = asar.getOrCreateArchive(path.resolve(fixturesDir, 'app.asar'));
+            const { paths, types } = archive.walk('pkg');
+            assert.deepStrictEqual(paths, ['lib.js', 'package.json'], 'walk should list descendants');
+            assert.deepStrictEqual(Array.from(types), [1, 1], 'walk should return file types');
+            assert.ok(archive.walk('', { maxDepth: 1 }).paths.every(p => !p.includes(path.sep)), 'walk should honor maxDepth');
+            assert.deepStrictEqual((await archive.walkAsync('')).paths, archive.walk('').paths, 'walkAsync should match walk');
+            await assert.rejects(archive.walkAsync('package.json'), 'walkAsync should reject for files');
+        });
+        it('async queries', async function () {
+            const archive = asar.getOrCreateArchive(path.resolve(fixturesDir, 'app.asar'));
+            assert.deepStrictEqual(await archive.statAsync('package.json'), archive.stat('package.json'), 'statAsync should match stat');
+            assert.deepStrictEqual(await archive.getFileInfoAsync('package.json'), archive.getFileInfo('package.json'), 'getFileInfoAsync should match getFileInfo');
+            assert.deepStrictEqual(await archive.readdirAsync('pkg'), archive.readdir('pkg'), 'readdirAsync should match readdir');
+            assert.strictEqual(await archive.realpathAsync('index-link.js'), archive.realpath('index-link.js'), 'realpathAsync should match realpath');
+            assert.strictEqual(await archive.statAsync('nonexistent.json'), false, 'statAsync should resolve false for nonexistent file');
+        });
+        it('verifyAll', async function () {
+            const archive = asar.getOrCreateArchive(path.resolve(fixturesDir, 'app.asar'));
+            const events = [];
+            const result = await archive.verifyAll({ threads: 2 }, event => events.push(event));
+            assert.strictEqual(result.failedFiles, 0, 'verifyAll should not report failures');
+            assert.strictEqual(result.verifiedFiles, result.totalFiles, 'verifyAll should verify all files');
+            assert.ok(events.every(event => !event.failedPath), 'verifyAll should only report progress');
+        });
+        it('fileOutLimits', function () {
+            const archive = asar.getOrCreateArchive(path.resolve(fixturesDir, 'app.asar'));
+            const pinned = archive.acquireFileOut('pkg/lib.js');
+            archive.setFileOutLimits({ maxEntries: 1 });
+            const copied = archive.copyFileOut('package.json');
+            assert.ok(fs.existsSync(pinned), 'acquired file should not be evicted');
+            assert.ok(fs.existsSync(copied), 'most recent file should not be evicted');
+            assert.ok(archive.releaseFileOut('pkg/lib.js'), 'releaseFileOut should release the handle');
+            archive.copyFileOut('index.js');
+            assert.ok(!fs.existsSync(pinned), 'released file should be evicted');
+            const fd = fs.openSync(path.resolve(fixturesDir, 'app.asar/pkg/package.json'), 'r');
+            const opened = archive.copyFileOut('pkg/package.json');
+            archive.copyFileOut('package.json');
+            archive.copyFileOut('index.js');
+            assert.strictEqual(archive.copyFileOut('pkg/package.json'), opened, 'files opened out of the archive should not be evicted');
+            assert.ok(fs.existsSync(opened), 'files opened out of the archive should stay on disk');
+            fs.closeSync(fd);
+            archive.setFileOutLimits({});
+        });
+        it('fileOutLimits release files opened through fs once closed', async function () {
+            const archive = asar.getOrCreateArchive(path.resolve(fixturesDir, 'app.asar'));
+            archive.setFileOutLimits({ maxEntries: 1 });
+            const evict = () => {
+                archive.copyFileOut('package.json');
+                archive.copyFileOut('index.js');
+            };
+            const openers = {
+                openSync: async (filePath) => {
+                    const fd = fs.openSync(filePath, 'r');
+                    return () => fs.closeSync(fd);
+                },
+                open: async (filePath) => {
+                    const fd = await new Promise((resolve, reject) => fs.open(filePath, 'r', (error, fd) => error ? reject(error) : resolve(fd)));
+                    return () => new Promise((resolve, reject) => fs.close(fd, (error) => error ? reject(error) : resolve()));
+                },
+                'promises.open': async (filePath) => {
+                    const handle = await fs.promises.open(filePath, 'r');
+                    return () => handle.close();
+                },
+            };
+            try {
+                for (const [name, open] of Object.entries(openers)) {
+                    const close = await open(path.resolve(fixturesDir, 'app.asar/pkg/package.json'));
+                    const opened = archive.copyFileOut('pkg/package.json');
+                    evict();
+                    assert.ok(fs.existsSync(opened), `files opened with ${name} should stay on disk while open`);
+                    await close();
+                    evict();
+                    assert.ok(!fs.existsSync(opened), `files opened with ${name} should be evicted once closed`);
+                }
+            }
+            finally {
+                archive.setFileOutLimits({});
+            }
+        });
+    });
+
+    describe('directory cache', () => {
+        const addon = require('node-gyp-build')(path.resolve(__dirname, '../..'));
+        const cacheDir = '/tmp/node-asar-addon/cache';
+        const delay = (ms) => new Promise((resolve) => setTimeout(resolve, ms));
+        before(() => {
+            fs.mkdirSync(path.join(cacheDir, 'dir.asar'), { recursive: true });
+        });
+        after(() => {
+            addon.configureDirectoryCache({});
+        });
+
+        it('caches probes of "*.asar" directories', function () {
+            addon.configureDirectoryCache({ ttlMs: 0, watch: false });
+            const start = addon.getDirectoryCacheStats();
+            assert.strictEqual(start.entries, 0, 'configureDirectoryCache should clear the cache');
+            assert.strictEqual(addon.splitPath(path.join(cacheDir, 'dir.asar/a.js')).isAsar, false, 'a "*.asar" directory is not an archive');
+            assert.strictEqual(addon.splitPath(path.join(cacheDir, 'dir.asar/b.js')).isAsar, false, 'a "*.asar" directory is not an archive');
+            const stats = addon.getDirectoryCacheStats();
+            assert.strictEqual(stats.misses, start.misses + 1, 'the first lookup should probe the directory');
+            assert.strictEqual(stats.hits, start.hits + 1, 'the second lookup should be cached');
+            assert.strictEqual(stats.entries, 1, 'one directory should be cached');
+        });
+        it('expires entries after ttlMs', async function () {
+            addon.configureDirectoryCache({ ttlMs: 20, watch: false });
+            const start = addon.getDirectoryCacheStats();
+            addon.splitPath(path.join(cacheDir, 'dir.asar/a.js'));
+            await delay(50);
+            addon.splitPath(path.join(cacheDir, 'dir.asar/a.js'));
+            const stats = addon.getDirectoryCacheStats();
+            assert.strictEqual(stats.misses, start.misses + 2, 'expired entries should be probed again');
+            assert.strictEqual(stats.invalidations, start.invalidations + 1, 'expired entries should be counted as invalidated');
+        });
+        it('evicts entries over maxEntries', function () {
+            addon.configureDirectoryCache({ maxEntries: 16, ttlMs: 0, watch: false });
+            const start = addon.getDirectoryCacheStats();
+            for (let i = 0; i < 40; i++) {
+                addon.splitPath(path.join(cacheDir, `missing-${i}.asar`, 'a.js'));
+            }
+            const stats = addon.getDirectoryCacheStats();
+            assert.ok(stats.entries <= 16, 'the cache should stay within maxEntries');
+            assert.strictEqual(stats.evictions - start.evictions, 40 - stats.entries, 'entries over the limit should be evicted');
+        });
+        it('invalidates entries on changes of the parent directory', async function () {
+            if (process.platform !== 'linux') this.skip();
+            addon.configureDirectoryCache({ ttlMs: 0, watch: true });
+            const dirPath = path.join(cacheDir, 'watched.asar');
+            fs.mkdirSync(dirPath);
+            assert.strictEqual(addon.splitPath(path.join(dirPath, 'package.json')).isAsar, false, 'a "*.asar" directory is not an archive');
+            const start = addon.getDirectoryCacheStats();
+            fs.rmdirSync(dirPath);
+            fs.copyFileSync(path.resolve(fixturesDir, 'app.asar'), dirPath);
+            for (let i = 0; i < 100 && addon.getDirectoryCacheStats().invalidations === start.invalidations; i++) {
+                await delay(10);
+            }
+            assert.ok(addon.getDirectoryCacheStats().invalidations > start.invalidations, 'the removed directory should be invalidated');
+            assert.strictEqual(addon.splitPath(path.join(dirPath, 'package.json')).isAsar, true, 'the new archive should be found');
+        });
+    });
+
+    describe('archive reload', () => {
+        const archivePath = '/tmp/node-asar-addon/reload.asar';
+        const delay = (ms) => new Promise((resolve) => setTimeout(resolve, ms));
+        // Replace the archive the way a deploy does, by renaming a new file over it.
+        const deploy = (content) => {
+            writeArchive(archivePath + '.tmp', { 'a.txt': { size: content.length, offset: '0' } }, Buffer.from(content));
+            fs.renameSync(archivePath + '.tmp', archivePath);
+        };
+        const waitForContent = async (content) => {
+            for (let i = 0; i < 200; i++) {
+                if (fs.readFileSync(path.join(archivePath, 'a.txt'), 'utf8') === content) return;
+                await delay(10);
+            }
+            assert.fail(`the archive should be reloaded with ${content}`);
+        };
+        after(() => {
+            asar.archives.loadArchives({ archives: [], reload: { enabled: false } });
+        });
+
+        it('keeps handed out fds open across reloads', async function () {
+            deploy('v1');
+            asar.archives.loadArchives({ archives: [archivePath], mirrorAsarBasePath: false, reload: { checkIntervalMs: 0, watch: false } });
+            assert.strictEqual(fs.readFileSync(path.join(archivePath, 'a.txt'), 'utf8'), 'v1', 'the first archive should be read');
+            const archive = asar.getOrCreateArchive(archivePath);
+            const fd = archive.getFdAndValidateIntegrityLater('a.txt');
+            assert.ok(fd >= 0, 'getFdAndValidateIntegrityLater should return an fd');
+            const { ino } = fs.fstatSync(fd);
+            const { offset } = archive.getFileInfo('a.txt');
+            const reloads = asar.getArchiveReloadStats().reloads;
+
+            // Two reloads, the first archive is no longer the current nor the replaced one.
+            deploy('v2');
+            await waitForContent('v2');
+            deploy('v3');
+            await waitForContent('v3');
+            assert.ok(asar.getArchiveReloadStats().reloads >= reloads + 2, 'both deploys should be reloaded');
+
+            assert.strictEqual(fs.fstatSync(fd).ino, ino, 'the fd should still refer to the first archive');
+            const buffer = Buffer.alloc(2);
+            fs.readSync(fd, buffer, 0, 2, offset);
+            assert.strictEqual(buffer.toString(), 'v1', 'the fd should still read the first archive');
+            assert.ok(archive.releaseFd(fd), 'releaseFd should release the fd');
+            assert.ok(!archive.releaseFd(fd), 'releaseFd should fail for fds not handed out');
+        });
+    });
+
+    describe('path index', () => {
+        const addon = require('node-gyp-build')(path.resolve(__dirname, '../..'));
+        const appPath = path.resolve(fixturesDir, 'app.asar');
+        after(() => {
+            addon.setPathIndexEnabled(false);
+            asar.archives._pathIndexEnabled = false;
+        });
+
+        it('answers probes inside opened archives', function () {
+            asar.archives.loadArchives({ archives: [], pathIndex: true });
+            const stats = asar.getPathIndexStats();
+            assert.ok(stats.enabled && stats.archives > 0 && stats.entries > 0, 'registered archives should be indexed');
+            assert.strictEqual(addon.indexedModuleStat(appPath), 1, 'the archive root should be a directory');
+            assert.strictEqual(addon.indexedModuleStat(path.join(appPath, 'pkg')), 1, 'directories should be found');
+            assert.strictEqual(addon.indexedModuleStat(path.join(appPath, 'pkg/lib.js')), 0, 'files should be found');
+            assert.strictEqual(addon.indexedModuleStat(path.join(appPath, 'pkg/missing.js')), -34, 'missing files should be reported');
+            assert.strictEqual(addon.indexedModuleStat(path.join(appPath, 'pkg/lib.js/x')), -34, 'paths below files should be missing');
+            assert.strictEqual(addon.indexedModuleStat(path.resolve(fixturesDir, 'asar-source/app/package.json')), false, 'paths outside archives should not be answered');
+            assert.strictEqual(addon.indexedModuleStat(appPath + '/pkg/../package.json'), false, 'paths that are not normalized should not be answered');
+            assert.strictEqual(require(path.join(appPath, 'pkg/package.json')).name, 'pkg', 'modules should resolve through the index');
+        });
+        it('drops the entries of unloaded archives only', function () {
+            const archivePath = '/tmp/node-asar-addon/indexed.asar';
+            writeArchive(archivePath, {
+                'a.js': { size: 2, offset: '0' },
+                'lib': { files: { 'b.js': { size: 2, offset: '2' } } },
+            }, Buffer.from('1;2;'));
+            asar.getOrCreateArchive(archivePath);
+            const before = asar.getPathIndexStats();
+            assert.strictEqual(addon.indexedModuleStat(path.join(archivePath, 'lib/b.js')), 0, 'opened archives should be indexed');
+
+            assert.ok(asar.archives.unload(archivePath), 'the archive should be unloaded');
+            const after = asar.getPathIndexStats();
+            assert.strictEqual(after.archives, before.archives - 1, 'the archive should be dropped');
+            assert.strictEqual(after.entries, before.entries - 4, 'the root and the three entries should be dropped');
+            assert.strictEqual(addon.indexedModuleStat(path.join(archivePath, 'lib/b.js')), false, 'unloaded archives should not be answered');
+            assert.strictEqual(addon.indexedModuleStat(path.join(appPath, 'pkg/lib.js')), 0, 'other archives should stay indexed');
+        });
+        it('keeps archives probed through the index loaded when idle', function () {
+            const idlePath = '/tmp/node-asar-addon/idle.asar';
+            const busyPath = '/tmp/node-asar-addon/busy.asar';
+            for (const archivePath of [idlePath, busyPath]) {
+                writeArchive(archivePath, { 'lib': { files: { 'b.js': { size: 2, offset: '0' } } } }, Buffer.from('1;'));
+                asar.getOrCreateArchive(archivePath);
+            }
+            assert.ok(!addon.unloadIdleArchives([appPath]).includes(busyPath), 'archives opened since the last sweep should stay loaded');
+
+            assert.strictEqual(addon.indexedModuleStat(path.join(busyPath, 'lib/b.js')), 0, 'the archive should be indexed');
+            const unloaded = addon.unloadIdleArchives([appPath]);
+            assert.ok(unloaded.includes(idlePath), 'archives not accessed should be unloaded');
+            assert.ok(!unloaded.includes(busyPath), 'archives probed through the index should stay loaded');
+            assert.ok(!unloaded.includes(appPath), 'archives used through their bindings should stay loaded');
+            assert.strictEqual(addon.indexedModuleStat(path.join(idlePath, 'lib/b.js')), false, 'unloaded archives should be dropped from the index');
+            assert.strictEqual(addon.indexedModuleStat(path.join(busyPath, 'lib/b.js')), 0, 'the archive should stay indexed');
+            asar.archives.unload(idlePath);
+            asar.archives.unload(busyPath);
+        });
     });
-});
\ No newline at end of file
+});
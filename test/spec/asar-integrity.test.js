@@ -0,0 +1,96 @@
+/* eslint-disable max-len */
+const path = require('path');
+const assert = require('assert');
+const { spawnSync } = require('child_process');
+const asar = require('./node-asar-addon');
+const { writeArchive, integrityOf } = require('./archive-helper');
+
+/**
+ * @type {import('fs')}
+ */
+let fs;
+const fixturesDir = path.resolve(__dirname, '../fixtures');
+const tmpDir = '/tmp/node-asar-addon-integrity';
+describe('asar integrity', () => {
+    before(() => {
+        asar.register({
+            archives: [
+                path.resolve(fixturesDir, 'app.asar'),
+            ],
+            validateIntegrity: true,
+        });
+        fs = require('fs');
+        fs.mkdirSync(tmpDir, { recursive: true });
+    });
+    after(() => {
+        fs.rmSync(tmpDir, { recursive: true });
+    });
+
+    it('empty file does not mark the next file verified', function () {
+        const archivePath = path.join(tmpDir, 'empty-then-tampered.asar');
+        writeArchive(archivePath, {
+            'a-empty': { size: 0, offset: '0', integrity: integrityOf(Buffer.alloc(0)) },
+            'b.txt': { size: 8, offset: '0', integrity: integrityOf(Buffer.from('original')) },
+        }, Buffer.from('tampered'));
+        const archive = asar.getOrCreateArchive(archivePath);
+        assert.ok(archive.validateIntegrity('a-empty', Buffer.alloc(0)), 'empty file should validate');
+        assert.throws(() => archive.read('b.txt'), /Integrity Violation/, 'file after an empty one should still be hashed');
+    });
+    // Reads `index.js` of a tampered archive in a child process, which
+    // should exit on the integrity violation.
+    const readTampered = (name, encoding) => {
+        const archivePath = path.join(tmpDir, name);
+        writeArchive(archivePath, {
+            'index.js': { size: 8, offset: '0', integrity: integrityOf(Buffer.from('original')) },
+        }, Buffer.from('tampered'));
+        const script = `
+            require(${JSON.stringify(path.resolve(__dirname, '../..'))}).register({ archives: [${JSON.stringify(archivePath)}], validateIntegrity: true });
+            require('fs').readFileSync(${JSON.stringify(path.join(archivePath, 'index.js'))}, ${JSON.stringify(encoding)});
+            console.log('read');
+        `;
+        return spawnSync(process.execPath, ['-e', script], { encoding: 'utf8' });
+    };
+
+    it('readSource fails closed', function () {
+        const child = readTampered('tampered-source.asar', 'utf8');
+        assert.strictEqual(child.status, 1, 'the process should exit on an integrity violation');
+        assert.match(child.stderr, /ASAR Integrity Violation/, 'the violation should be reported');
+        assert.ok(!child.stdout.includes('read'), 'the tampered source should never be returned');
+    });
+    it('encoded reads fail closed', function () {
+        const child = readTampered('tampered-latin1.asar', 'latin1');
+        assert.strictEqual(child.status, 1, 'the process should exit on an integrity violation');
+        assert.match(child.stderr, /ASAR Integrity Violation/, 'the violation should be reported');
+        assert.ok(!child.stdout.includes('read'), 'the tampered content should never be returned');
+    });
+    it('verifyAll', async function () {
+        const archive = asar.getOrCreateArchive(path.resolve(fixturesDir, 'app.asar'));
+        const events = [];
+        const result = await archive.verifyAll({ threads: 2 }, event => events.push(event));
+        assert.ok(result.totalFiles > 0 && result.totalBytes > 0, 'verifyAll should find files with integrity');
+        assert.strictEqual(result.verifiedFiles, result.totalFiles, 'verifyAll should verify all files');
+        assert.strictEqual(result.verifiedBytes, result.totalBytes, 'verifyAll should verify all bytes');
+        assert.strictEqual(result.failedFiles, 0, 'verifyAll should not report failures');
+        assert.ok(events.length > 0 && events.every(event => !event.failedPath), 'verifyAll should only report progress');
+
+        const stats = archive.getIntegrityStats();
+        assert.ok(stats.verifiedFiles > 0 && stats.hashedBytes > 0, 'verified files should be counted');
+        archive.read('package.json');
+        assert.strictEqual(archive.getIntegrityStats().skippedReads, stats.skippedReads + 1, 'reads of verified files should skip hashing');
+    });
+    it('verifyAll reports tampered files', async function () {
+        const archivePath = path.join(tmpDir, 'tampered.asar');
+        writeArchive(archivePath, {
+            'good.txt': { size: 4, offset: '0', integrity: integrityOf(Buffer.from('good')) },
+            'bad.txt': { size: 8, offset: '4', integrity: integrityOf(Buffer.from('original')) },
+        }, Buffer.from('goodtampered'));
+        const archive = asar.getOrCreateArchive(archivePath);
+        const failures = [];
+        const result = await archive.verifyAll({ threads: 1 }, event => event.failedPath && failures.push(event.failedPath));
+        assert.strictEqual(result.totalFiles, 2, 'verifyAll should count both files');
+        assert.strictEqual(result.verifiedFiles, 1, 'the intact file should verify');
+        assert.strictEqual(result.failedFiles, 1, 'the tampered file should fail');
+        assert.deepStrictEqual(failures, ['bad.txt'], 'the tampered file should be reported');
+        assert.strictEqual(archive.getIntegrityStats().verifiedFiles, 1, 'only the intact file should be marked verified');
+    });
+});
@@ -22,6 +22,21 @@ describe('asar archive', () => {
             assert.strictEqual(modulePath, archivePath + '/common/index.js', 'Module path should match');
         });
 
+        it('longest mount point wins', function () {
+            const appPath = path.resolve(__dirname, '../fixtures/app');
+            const archivePath = path.resolve(__dirname, '../fixtures/app.asar');
+            asar.archives.mount(appPath + '/vendor', archivePath + '/node_modules');
+            try {
+                assert.strictEqual(asar.archives.resolveArchiveMapping(appPath + '/vendor/mime-types/index.js'), archivePath + '/node_modules/mime-types/index.js');
+                assert.strictEqual(asar.archives.resolveArchiveMapping(appPath + '/vendorx/index.js'), archivePath + '/vendorx/index.js');
+                assert.strictEqual(asar.archives.resolveArchiveMapping(appPath + 'x/index.js'), null);
+            }
+            finally {
+                assert.ok(asar.archives.unmount(appPath + '/vendor'));
+            }
+            assert.strictEqual(asar.archives.resolveArchiveMapping(appPath + '/vendor/index.js'), archivePath + '/vendor/index.js');
+        });
+
         it('normal node_modules require', function () {
             assert.ok(require('semver').SEMVER_SPEC_VERSION, 'semver should be available');
             assert.ok(require('../fixtures/app/new-module/no-asar.js').version, 'normal module should be available');
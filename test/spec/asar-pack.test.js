@@ -0,0 +1,265 @@
+/* eslint-disable max-len */
+const path = require('path');
+const assert = require('assert');
+const crypto = require('crypto');
+const { execFileSync } = require('child_process');
+const electronAsar = require('@electron/asar');
+const asar = require('./node-asar-addon');
+
+/**
+ * @type {import('fs')}
+ */
+let fs = require('fs');
+const fixturesDir = path.resolve(__dirname, '../fixtures');
+const sourceDir = path.resolve(fixturesDir, 'asar-source/app');
+const buildDir = path.resolve(__dirname, '../../build/Release');
+const tmpDir = '/tmp/node-asar-addon-pack';
+
+const pack = (source, dest, ...options) => execFileSync(path.join(buildDir, 'asar_pack'), [...options, source, dest]);
+const convert = (...args) => execFileSync(path.join(buildDir, 'asar_convert'), args, { encoding: 'utf8' });
+const delay = (ms) => new Promise((resolve) => setTimeout(resolve, ms));
+
+// Writes `files`, a map of relative paths to contents, below `dir`.
+const writeTree = (dir, files) => {
+    for (const [filePath, content] of Object.entries(files)) {
+        fs.mkdirSync(path.dirname(path.join(dir, filePath)), { recursive: true });
+        fs.writeFileSync(path.join(dir, filePath), content);
+    }
+};
+
+// Size of the payloads after the header.
+const payloadSize = (archivePath) => fs.statSync(archivePath).size - 8 - electronAsar.getRawHeader(archivePath).headerSize;
+
+// The file and link entries of an archive header by path.
+const headerEntries = (archivePath) => {
+    const entries = {};
+    const walk = (node, prefix) => {
+        for (const [name, entry] of Object.entries(node.files)) {
+            if (entry.files) {
+                walk(entry, prefix + name + '/');
+            } else {
+                entries[prefix + name] = entry;
+            }
+        }
+    };
+    walk(electronAsar.getRawHeader(archivePath).header, '');
+    return entries;
+};
+
+describe('asar pack', () => {
+    before(function () {
+        if (!fs.existsSync(path.join(buildDir, 'asar_pack'))) this.skip();
+        asar.register({ archives: [] });
+        fs = require('fs');
+        fs.mkdirSync(tmpDir, { recursive: true });
+    });
+    after(() => {
+        fs.rmSync(tmpDir, { recursive: true, force: true });
+    });
+
+    it('packs archives that @electron/asar reads', function () {
+        const archivePath = path.join(tmpDir, 'app.asar');
+        pack(sourceDir, archivePath);
+        const packed = headerEntries(archivePath);
+        const expected = headerEntries(path.resolve(fixturesDir, 'app.asar'));
+        assert.deepStrictEqual(Object.keys(packed).sort(), Object.keys(expected).sort(), 'the same files should be packed');
+        for (const [filePath, entry] of Object.entries(packed)) {
+            if (entry.link) {
+                assert.strictEqual(entry.link, expected[filePath].link, `${filePath} should link to the same target`);
+                continue;
+            }
+            assert.strictEqual(entry.size, expected[filePath].size, `${filePath} should have the same size`);
+            assert.deepStrictEqual(entry.integrity, expected[filePath].integrity, `${filePath} should have the same integrity`);
+            assert.strictEqual(!!entry.executable, !!expected[filePath].executable, `${filePath} should keep its mode`);
+            assert.ok(electronAsar.extractFile(archivePath, filePath).equals(fs.readFileSync(path.join(sourceDir, filePath))), `${filePath} should be extracted as packed`);
+        }
+    });
+    it('packs archives that the addon reads', function () {
+        const archivePath = path.join(tmpDir, 'addon.asar');
+        pack(sourceDir, archivePath, '--concurrency=4');
+        asar.archives.loadArchives({ archives: [archivePath], mirrorAsarBasePath: false });
+        const archive = asar.getOrCreateArchive(archivePath);
+        for (const [filePath, entry] of Object.entries(headerEntries(archivePath))) {
+            if (entry.link) continue;
+            const content = fs.readFileSync(path.join(sourceDir, filePath));
+            assert.ok(archive.read(filePath).equals(content), `${filePath} should be read as packed`);
+            assert.ok(fs.readFileSync(path.join(archivePath, filePath)).equals(content), `${filePath} should be read through fs`);
+        }
+        assert.strictEqual(fs.readFileSync(path.join(archivePath, 'index-link.js'), 'utf8'), fs.readFileSync(path.join(sourceDir, 'index.js'), 'utf8'), 'links should be followed');
+    });
+    it('deduplicates identical files', function () {
+        const source = path.join(tmpDir, 'dedup-source');
+        const content = crypto.randomBytes(100 * 1024);
+        const files = {
+            'a/x.bin': content,
+            'b/x.bin': content,
+            'b/c/x.bin': content,
+            'b/y.bin': Buffer.concat([content, Buffer.from('!')]),
+        };
+        writeTree(source, files);
+        const plainPath = path.join(tmpDir, 'plain.asar');
+        const dedupPath = path.join(tmpDir, 'dedup.asar');
+        pack(source, plainPath);
+        pack(source, dedupPath, '--dedup');
+
+        const entries = headerEntries(dedupPath);
+        assert.strictEqual(entries['b/x.bin'].offset, entries['a/x.bin'].offset, 'identical files should share their payload');
+        assert.strictEqual(entries['b/c/x.bin'].offset, entries['a/x.bin'].offset, 'identical files should share their payload');
+        assert.notStrictEqual(entries['b/y.bin'].offset, entries['a/x.bin'].offset, 'different files should not share their payload');
+        assert.deepStrictEqual(entries['b/x.bin'].integrity, entries['a/x.bin'].integrity, 'shared payloads should copy the integrity');
+        assert.deepStrictEqual(entries['a/x.bin'].integrity, headerEntries(plainPath)['a/x.bin'].integrity, 'the integrity should be the one of the content');
+        assert.strictEqual(payloadSize(dedupPath), payloadSize(plainPath) - 2 * content.length, 'duplicates should be stored once');
+
+        const archive = asar.getOrCreateArchive(dedupPath);
+        for (const [filePath, expected] of Object.entries(files)) {
+            assert.ok(electronAsar.extractFile(dedupPath, filePath).equals(expected), `${filePath} should be extracted by @electron/asar`);
+            assert.ok(archive.read(filePath).equals(expected), `${filePath} should be read by the addon`);
+        }
+    });
+    it('aligns selected files', function () {
+        const source = path.join(tmpDir, 'align-source');
+        // Enough modules that aligning the offsets grows the header.
+        const files = {
+            'lib/native.node': crypto.randomBytes(5001),
+            'module.wasm': crypto.randomBytes(7777),
+            'big.dat': crypto.randomBytes(1024 * 1024 + 1),
+            'small.dat': crypto.randomBytes(1000),
+        };
+        for (let i = 0; i < 300; i++) files[`lib/m${i}.js`] = `module.exports = ${i};\n`;
+        writeTree(source, files);
+        const aligned = ['lib/native.node', 'module.wasm', 'big.dat'];
+
+        for (const alignment of [4096, 65536]) {
+            const archivePath = path.join(tmpDir, `aligned-${alignment}.asar`);
+            pack(source, archivePath, `--align=${alignment}`);
+            const { headerSize } = electronAsar.getRawHeader(archivePath);
+            const entries = headerEntries(archivePath);
+            for (const filePath of aligned) {
+                const position = 8 + headerSize + Number(entries[filePath].offset);
+                assert.strictEqual(position % alignment, 0, `${filePath} should start at a multiple of ${alignment}`);
+            }
+            asar.archives.loadArchives({ archives: [archivePath], mirrorAsarBasePath: false });
+            const archive = asar.getOrCreateArchive(archivePath);
+            for (const [filePath, expected] of Object.entries(files)) {
+                assert.ok(electronAsar.extractFile(archivePath, filePath).equals(Buffer.from(expected)), `${filePath} should be extracted by @electron/asar`);
+                assert.ok(archive.read(filePath).equals(Buffer.from(expected)), `${filePath} should be read by the addon`);
+            }
+            for (const filePath of aligned) {
+                const mapped = archive.mapEntry(filePath);
+                assert.ok(mapped instanceof ArrayBuffer, `${filePath} should be mapped`);
+                assert.ok(Buffer.from(mapped).equals(files[filePath]), `${filePath} should be mapped with its content`);
+            }
+        }
+    });
+
+    describe('binary header', () => {
+        const files = {
+            'a.txt': 'a',
+            'b/c.txt': 'c'.repeat(10000),
+            'b/d.txt': 'd',
+        };
+        // Offsets in the table, see BinaryHeader.
+        const kTableOffset = 8;
+        const kRecordsOffset = kTableOffset + 32;
+        const kRecordSize = 56;
+        let source;
+        before(() => {
+            source = path.join(tmpDir, 'binary-source');
+            writeTree(source, files);
+        });
+        after(() => {
+            asar.archives.loadArchives({ archives: [], reload: { enabled: false } });
+        });
+
+        it('reads archives with a binary header', function () {
+            const archivePath = path.join(tmpDir, 'binary.asar');
+            pack(sourceDir, archivePath, '--binary-header');
+            assert.strictEqual(fs.readFileSync(archivePath).readUInt32LE(0), 0x32560004, 'the header should be binary');
+            assert.match(convert(archivePath), /already binary/, 'converting to the same format should be reported as a no-op');
+            asar.archives.loadArchives({ archives: [archivePath], mirrorAsarBasePath: false });
+            const archive = asar.getOrCreateArchive(archivePath);
+            assert.ok(archive, 'the archive should be opened');
+            const expected = headerEntries(path.resolve(fixturesDir, 'app.asar'));
+            for (const [filePath, entry] of Object.entries(expected)) {
+                if (entry.link) continue;
+                const content = fs.readFileSync(path.join(sourceDir, filePath));
+                assert.ok(archive.read(filePath).equals(content), `${filePath} should be read`);
+                assert.strictEqual(fs.statSync(path.join(archivePath, filePath)).size, entry.size, `${filePath} should have its size`);
+            }
+            assert.deepStrictEqual(fs.readdirSync(path.join(archivePath, 'pkg')).sort(), fs.readdirSync(path.join(sourceDir, 'pkg')).sort(), 'directories should be listed');
+            assert.strictEqual(fs.readFileSync(path.join(archivePath, 'index-link.js'), 'utf8'), fs.readFileSync(path.join(sourceDir, 'index.js'), 'utf8'), 'links should be followed');
+        });
+        it('rejects corrupt binary headers', function () {
+            const archivePath = path.join(tmpDir, 'binary-valid.asar');
+            pack(source, archivePath, '--binary-header');
+            assert.ok(asar.getOrCreateArchive(archivePath), 'the valid archive should be opened');
+            const valid = fs.readFileSync(archivePath);
+            const entryCount = valid.readUInt32LE(kTableOffset + 4);
+            const corruptions = {
+                version: (buffer) => buffer.writeUInt32LE(3, kTableOffset),
+                'table size': (buffer) => buffer.writeBigUInt64LE(buffer.readBigUInt64LE(kTableOffset + 24) + 8n, kTableOffset + 24),
+                'root type': (buffer) => buffer.writeUInt8(1, kRecordsOffset + 48),
+                'child before its parent': (buffer) => buffer.writeUInt32LE(0, kRecordsOffset + 28),
+                'children out of range': (buffer) => buffer.writeUInt32LE(entryCount, kRecordsOffset + 32),
+                'path out of the strings': (buffer) => buffer.writeUInt32LE(0xffffffff, kRecordsOffset + kRecordSize + 16),
+                'record type': (buffer) => buffer.writeUInt8(7, kRecordsOffset + kRecordSize + 48),
+                'sorted index out of range': (buffer) => buffer.writeUInt32LE(entryCount, kRecordsOffset + entryCount * kRecordSize),
+            };
+            for (const [name, corrupt] of Object.entries(corruptions)) {
+                const corruptPath = path.join(tmpDir, `binary-${name.replace(/ /g, '-')}.asar`);
+                const buffer = Buffer.from(valid);
+                corrupt(buffer);
+                fs.writeFileSync(corruptPath, buffer);
+                assert.strictEqual(asar.getOrCreateArchive(corruptPath), null, `a header with a corrupt ${name} should be rejected`);
+            }
+        });
+        it('converts archives in both directions', function () {
+            const archivePath = path.join(tmpDir, 'convert.asar');
+            pack(source, archivePath);
+            const entries = headerEntries(archivePath);
+
+            assert.match(convert(archivePath), /rewritten in place/, 'a smaller binary header should be written in place');
+            assert.strictEqual(fs.readFileSync(archivePath).readUInt32LE(0), 0x32560004, 'the header should be binary');
+            const binary = asar.getOrCreateArchive(archivePath);
+            for (const [filePath, content] of Object.entries(files)) {
+                assert.strictEqual(binary.read(filePath).toString(), content, `${filePath} should be read from the binary header`);
+            }
+
+            assert.match(convert('--to-json', archivePath), /copied/, 'binary headers should never be written in place');
+            const converted = headerEntries(archivePath);
+            for (const [filePath, content] of Object.entries(files)) {
+                assert.strictEqual(converted[filePath].size, entries[filePath].size, `${filePath} should keep its size`);
+                assert.deepStrictEqual(converted[filePath].integrity, entries[filePath].integrity, `${filePath} should keep its integrity`);
+                assert.strictEqual(electronAsar.extractFile(archivePath, filePath).toString(), content, `${filePath} should be extracted by @electron/asar`);
+            }
+        });
+        it('reloads archives converted in place', async function () {
+            const archivePath = path.join(tmpDir, 'convert-reload.asar');
+            pack(source, archivePath);
+            asar.archives.loadArchives({ archives: [archivePath], mirrorAsarBasePath: false, reload: { checkIntervalMs: 0, watch: false } });
+            const read = () => fs.readFileSync(path.join(archivePath, 'b/c.txt'), 'utf8');
+            assert.strictEqual(read(), files['b/c.txt'], 'the JSON header should be read');
+            const waitForReload = async (reloads) => {
+                for (let i = 0; i < 200 && asar.getArchiveReloadStats().reloads === reloads; i++) {
+                    assert.strictEqual(read(), files['b/c.txt'], 'reads should not fail while the archive is reloaded');
+                    await delay(10);
+                }
+                assert.ok(asar.getArchiveReloadStats().reloads > reloads, 'the converted archive should be reloaded');
+            };
+
+            // Modification times have a coarse granularity on some file systems.
+            await delay(20);
+            let reloads = asar.getArchiveReloadStats().reloads;
+            const { ino } = fs.statSync(archivePath);
+            convert(archivePath);
+            assert.strictEqual(fs.statSync(archivePath).ino, ino, 'the header should be written in place');
+            await waitForReload(reloads);
+            assert.strictEqual(read(), files['b/c.txt'], 'the binary header should be read');
+
+            reloads = asar.getArchiveReloadStats().reloads;
+            convert('--to-json', archivePath);
+            await waitForReload(reloads);
+            assert.strictEqual(read(), files['b/c.txt'], 'the JSON header should be read again');
+        });
+    });
+});